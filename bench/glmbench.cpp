@@ -0,0 +1,261 @@
+//
+// glm microbenchmarks: the matrix and quaternion calls of the hot paths,
+//   timed in one build per instruction set (see the glmbench target of the
+//   Makefile)
+//
+// glm only takes its SSE paths for aligned types; glm::mat4, which the
+//   program uses, is packed and gets whatever the compiler makes of the
+//   scalar code for the target.  Both are timed, as "packed" and "aligned".
+//
+// Every call runs over Count different inputs, so the time per call includes
+//   loading and storing them, as it would in the program.  A run repeats the
+//   pass over them for at least PassMs; the best of Runs is reported.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#if defined(GLM_FORCE_PURE)
+static const char *ConfigName = "pure";
+#elif defined(GLM_FORCE_AVX2)
+static const char *ConfigName = "avx2";
+#elif defined(GLM_FORCE_AVX)
+static const char *ConfigName = "avx";
+#elif defined(GLM_FORCE_SSE2)
+static const char *ConfigName = "sse2";
+#else
+static const char *ConfigName = "default";
+#endif
+
+static const int Count = 1024;
+static const int Runs = 5;
+static const double PassMs = 20.0;
+
+// Keeps the compiler from merging or dropping the repeated passes
+static inline void clobber()
+{
+#if defined(__GNUC__)
+	asm volatile("" ::: "memory");
+#endif
+}
+
+static volatile float sink;
+
+//----------------------------------------------------------------------------
+
+template <glm::qualifier Q>
+struct Inputs
+{
+	typedef glm::mat<4, 4, float, Q> Mat;
+	typedef glm::vec<4, float, Q> Vec4;
+	typedef glm::vec<3, float, Q> Vec3;
+	typedef glm::qua<float, Q> Quat;
+
+	std::vector<Mat> a, b;
+	std::vector<Vec4> points;
+	std::vector<Vec3> offsets, axes;
+	std::vector<float> angles;
+	std::vector<Quat> p, q;
+
+	// what the calls write, read back into sink once they are timed
+	std::vector<Mat> mats;
+	std::vector<Vec4> vecs;
+	std::vector<Vec3> vec3s;
+	std::vector<Quat> quats;
+	std::vector<float> floats;
+};
+
+// Rigid transforms with a scale, like the part matrices of the program, so
+//   every inverse exists; the same numbers for every config
+template <glm::qualifier Q>
+static void makeInputs(Inputs<Q> &in)
+{
+	typedef typename Inputs<Q>::Mat Mat;
+	typedef typename Inputs<Q>::Vec3 Vec3;
+	typedef typename Inputs<Q>::Vec4 Vec4;
+
+	unsigned seed = 12345;
+	auto random = [&seed](float low, float high) {
+		seed = seed * 1664525u + 1013904223u;
+		return low + (high - low) * (float)(seed >> 8) / (float)(1 << 24);
+	};
+	auto randomAxis = [&random]() {
+		return glm::normalize(Vec3(random(-1, 1), random(-1, 1), random(0.1f, 1)));
+	};
+	auto randomMat = [&]() {
+		Mat m = glm::translate(Mat(1.0f), Vec3(random(-5, 5), random(-5, 5), random(-5, 5)));
+		m = glm::rotate(m, random(-3, 3), randomAxis());
+		return glm::scale(m, Vec3(random(0.5f, 2), random(0.5f, 2), random(0.5f, 2)));
+	};
+
+	for (int i = 0; i < Count; i++)
+	{
+		in.a.push_back(randomMat());
+		in.b.push_back(randomMat());
+		in.points.push_back(Vec4(random(-1, 1), random(-1, 1), random(-1, 1), 1.0f));
+		in.offsets.push_back(Vec3(random(-1, 1), random(-1, 1), random(-1, 1)));
+		in.axes.push_back(randomAxis());
+		in.angles.push_back(random(-3, 3));
+		in.p.push_back(glm::angleAxis(random(-3, 3), randomAxis()));
+		in.q.push_back(glm::angleAxis(random(-3, 3), randomAxis()));
+	}
+	in.mats.resize(Count);
+	in.vecs.resize(Count);
+	in.vec3s.resize(Count);
+	in.quats.resize(Count);
+	in.floats.resize(Count);
+}
+
+// Best ns per call of pass, which makes Count calls
+template <typename Pass>
+static double timePass(Pass pass)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	pass(); // warm up caches and branch predictors
+	double best = 1.0e30;
+	for (int r = 0; r < Runs; r++)
+	{
+		long long calls = 0;
+		Clock::time_point start = Clock::now();
+		std::chrono::duration<double, std::milli> elapsed;
+		do
+		{
+			pass();
+			clobber();
+			calls += Count;
+			elapsed = Clock::now() - start;
+		} while (elapsed.count() < PassMs);
+		best = glm::min(best, elapsed.count() * 1.0e6 / calls);
+	}
+	return best;
+}
+
+static void report(const char *storage, const char *op, double ns)
+{
+	printf("%s\t%s\t%s\t%.2f\t%.1f\n", ConfigName, storage, op, ns, 1000.0 / ns);
+	fflush(stdout);
+}
+
+//----------------------------------------------------------------------------
+
+template <glm::qualifier Q>
+static void runSuite(const char *storage)
+{
+	Inputs<Q> in;
+	makeInputs(in);
+
+	report(storage, "translate", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.mats[i] = glm::translate(in.a[i], in.offsets[i]);
+		   }));
+	sink = in.mats[Count - 1][3][0];
+
+	report(storage, "rotate", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.mats[i] = glm::rotate(in.a[i], in.angles[i], in.axes[i]);
+		   }));
+	sink = in.mats[Count - 1][0][0];
+
+	report(storage, "scale", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.mats[i] = glm::scale(in.a[i], in.offsets[i]);
+		   }));
+	sink = in.mats[Count - 1][0][0];
+
+	report(storage, "mat4 * mat4", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.mats[i] = in.a[i] * in.b[i];
+		   }));
+	sink = in.mats[Count - 1][0][0];
+
+	report(storage, "mat4 * vec4", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.vecs[i] = in.a[i] * in.points[i];
+		   }));
+	sink = in.vecs[Count - 1].x;
+
+	report(storage, "inverse", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.mats[i] = glm::inverse(in.a[i]);
+		   }));
+	sink = in.mats[Count - 1][0][0];
+
+	report(storage, "transpose", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.mats[i] = glm::transpose(in.a[i]);
+		   }));
+	sink = in.mats[Count - 1][0][1];
+
+	report(storage, "determinant", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.floats[i] = glm::determinant(in.a[i]);
+		   }));
+	sink = in.floats[Count - 1];
+
+	report(storage, "quat * quat", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.quats[i] = in.p[i] * in.q[i];
+		   }));
+	sink = in.quats[Count - 1].w;
+
+	report(storage, "quat * vec3", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.vec3s[i] = in.p[i] * in.offsets[i];
+		   }));
+	sink = in.vec3s[Count - 1].x;
+
+	report(storage, "mat4_cast", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.mats[i] = glm::mat4_cast(in.p[i]);
+		   }));
+	sink = in.mats[Count - 1][0][0];
+
+	report(storage, "slerp", timePass([&]() {
+			   for (int i = 0; i < Count; i++)
+				   in.quats[i] = glm::slerp(in.p[i], in.q[i], 0.3f);
+		   }));
+	sink = in.quats[Count - 1].w;
+}
+
+//----------------------------------------------------------------------------
+
+static bool configSupported()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+#  if defined(GLM_FORCE_AVX2)
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#  elif defined(GLM_FORCE_AVX)
+	return __builtin_cpu_supports("avx");
+#  endif
+#endif
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	bool header = !(argc > 1 && strcmp(argv[1], "-noheader") == 0);
+	if (header)
+		printf("config\tstorage\top\tns/op\tMops/s\n");
+
+	// an instruction the CPU lacks would kill the process mid-table
+	if (!configSupported())
+	{
+		printf("%s\t-\t-\t-\tunsupported\n", ConfigName);
+		return EXIT_SUCCESS;
+	}
+
+	runSuite<glm::highp>("packed");
+#if GLM_CONFIG_ALIGNED_GENTYPES == GLM_ENABLE
+	runSuite<glm::aligned_highp>("aligned");
+#endif
+	return EXIT_SUCCESS;
+}
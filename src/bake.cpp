@@ -0,0 +1,158 @@
+//
+// Walk cycle baked into a texture buffer and blended on the GPU
+//
+
+#include <cmath>
+#include <vector>
+
+#include "bake.h"
+#include "camera.h"
+#include "cubemesh.h"
+#include "glstate.h"
+#include "herd.h"
+#include "profiler.h"
+#include "reflect.h"
+#include "rig.h"
+#include "shaders.h"
+
+int bakePhases = 64;
+
+static std::vector<glm::mat4> bakedModels; // bakePhases * NumRigModels
+
+static GLuint bakeProgram;
+static GLuint bakeVaos[NumCubeLayouts];
+static GLuint bakeBuffer, bakeTexture;
+
+static UniformHandle<glm::mat4> worldMatrix;
+static UniformHandle<float> cycleTime;
+
+//----------------------------------------------------------------------------
+
+// Blend of the two baked poses either side of timeMs, as the shader does it
+static glm::mat4 blendedModel(float timeMs, int part)
+{
+	float t = fmod(timeMs, RigWalkPeriod) / RigWalkPeriod * bakePhases;
+	int phase = glm::min((int)t, bakePhases - 1);
+
+	const glm::mat4 &before = bakedModels[phase * NumRigModels + part];
+	const glm::mat4 &after = bakedModels[(phase + 1) % bakePhases * NumRigModels + part];
+	return before + (after - before) * (t - floorf(t));
+}
+
+void bakeReport(std::ostream &os)
+{
+	const int samples = 1000;
+	RigPose pose;
+	pose.valid = false;
+
+	double maxError = 0.0, sumError = 0.0;
+	int count = 0;
+
+	for (int s = 0; s < samples; s++)
+	{
+		// sample between the bake points, where the blend is furthest off
+		float timeMs = (s + 0.5f) / samples * RigWalkPeriod;
+		rigEvaluate(pose, rigWalkCycle(timeMs));
+
+		for (int part = 0; part < NumRigModels; part++)
+		{
+			glm::mat4 baked = blendedModel(timeMs, part);
+			for (int c = 0; c < 8; c++)
+			{
+				glm::vec4 corner(c & 1 ? 0.5f : -0.5f, c & 2 ? 0.5f : -0.5f, c & 4 ? 0.5f : -0.5f, 1.0f);
+				double error = glm::length(glm::vec3(baked * corner - pose.model[part] * corner));
+				maxError = glm::max(maxError, error);
+				sumError += error;
+				count++;
+			}
+		}
+	}
+
+	// the body is 1.4 units long
+	os << "bake: " << bakePhases << " phases x " << NumRigModels << " parts ("
+	   << bakedModels.size() * sizeof(glm::mat4) / 1024 << " KB), corner error max " << maxError << " mean "
+	   << sumError / count << " (" << 100.0 * maxError / 1.4 << "% of the body length)" << std::endl;
+}
+
+//----------------------------------------------------------------------------
+
+// Uniforms and bindings of bakeProgram, again after every reload
+static void setupBakeProgram()
+{
+	stateUseProgram(bakeProgram);
+	reflectSet(bakeProgram, "bakedPoses", 0);
+	reflectSet(bakeProgram, "bakePhases", bakePhases);
+	reflectSet(bakeProgram, "partCount", (int)NumRigModels);
+	reflectSet(bakeProgram, "cyclePeriod", RigWalkPeriod);
+	worldMatrix = reflectUniform<glm::mat4>(bakeProgram, "mWorld");
+	cycleTime = reflectUniform<float>(bakeProgram, "cycleTime");
+
+	cubeMeshBindProgram(bakeProgram);
+	cameraBindProgram(bakeProgram);
+}
+
+void bakeInit()
+{
+	GLint maxTexels;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	if (bakePhases * NumRigModels * 4 > maxTexels)
+	{
+		bakePhases = maxTexels / (NumRigModels * 4);
+		std::cerr << "bake: texture buffers are limited to " << maxTexels << " texels, baking " << bakePhases
+				  << " phases" << std::endl;
+	}
+
+	bakedModels.resize((size_t)bakePhases * NumRigModels);
+
+	RigPose pose;
+	pose.valid = false;
+	for (int phase = 0; phase < bakePhases; phase++)
+	{
+		rigEvaluate(pose, rigWalkCycle(phase * RigWalkPeriod / bakePhases));
+		for (int part = 0; part < NumRigModels; part++)
+			bakedModels[phase * NumRigModels + part] = pose.model[part];
+	}
+
+	bakeReport(std::cout);
+
+	// four RGBA32F texels per matrix, one column each
+	glGenBuffers(1, &bakeBuffer);
+	stateBindBuffer(GL_TEXTURE_BUFFER, bakeBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, bakedModels.size() * sizeof(glm::mat4), &bakedModels[0], GL_STATIC_DRAW);
+
+	glGenTextures(1, &bakeTexture);
+	stateBindTexture(0, GL_TEXTURE_BUFFER, bakeTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, bakeBuffer);
+
+	bakeProgram = InitShader("src/vshader_baked.glsl", "src/fshader.glsl");
+
+	glGenVertexArrays(NumCubeLayouts, bakeVaos);
+	for (int l = 0; l < NumCubeLayouts; l++)
+	{
+		stateBindVertexArray(bakeVaos[l]);
+		cubeMeshAttribs((CubeLayout)l, bakeProgram);
+		herdInstanceAttribs(bakeProgram, NumRigModels);
+	}
+	stateBindVertexArray(0);
+
+	setupBakeProgram();
+	shaderWatch(bakeProgram, setupBakeProgram);
+}
+
+//----------------------------------------------------------------------------
+
+void bakeDraw(const glm::mat4 &worldMat, float timeMs)
+{
+	herdUpdateInstances();
+
+	ProfileScope scope(PROFILE_SUBMIT);
+
+	stateUseProgram(bakeProgram);
+	uniformSet(worldMatrix, worldMat);
+	uniformSet(cycleTime, fmodf(timeMs, RigWalkPeriod));
+
+	stateBindTexture(0, GL_TEXTURE_BUFFER, bakeTexture);
+
+	stateBindVertexArray(bakeVaos[cubeLayout]);
+	cubeMeshDraw(herdSize * NumRigModels);
+}
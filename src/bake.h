@@ -0,0 +1,41 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _BAKE_H_
+#define _BAKE_H_
+
+#include <iostream>
+
+#include "cube.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Baked walk cycle ---
+//
+//   The walk cycle is periodic, so every pose an elephant can take is known
+//     up front.  bakeInit() samples bakePhases evenly spaced poses of one
+//     cycle into a texture buffer of part model matrices.  The baked vertex
+//     shader picks the two poses either side of an instance's cycle time and
+//     blends them, so drawing the herd costs no matrix math on the CPU: the
+//     per-elephant placements and phase offsets are uploaded once, when the
+//     herd changes, and a frame only sets the time and world uniforms.
+//
+//   Blending matrices entry by entry is not a rotation, so baked poses drift
+//     from the analytic ones between samples; bakeReport() measures how far.
+//
+
+extern int bakePhases; // poses per cycle, set before bakeInit()
+
+// Bake the cycle, build the program and report the bake error
+void bakeInit();
+
+// Largest and mean distance of a cube corner from its analytic position
+//   over many times in the cycle
+void bakeReport(std::ostream &os);
+
+// Draw the whole herd from the bake at animation time timeMs
+void bakeDraw(const glm::mat4 &worldMat, float timeMs);
+
+#endif // _BAKE_H_
@@ -0,0 +1,247 @@
+//
+// Scripted benchmark timeline, JSON results and baseline comparison
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "bench.h"
+
+//----------------------------------------------------------------------------
+
+bool benchLoadScript(const char *path, BenchScript &script)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		std::cerr << "bench: cannot read " << path << std::endl;
+		return false;
+	}
+
+	script.name = path;
+	script.frames = 300;
+	script.warmup = 10;
+	script.tickMs = 20.0f;
+	script.herd = 1;
+	script.width = script.height = 700;
+	script.submit = "uniform";
+	script.layout = "flat";
+	script.camera.clear();
+	script.anim.clear();
+
+	std::string line;
+	for (int number = 1; std::getline(in, line); number++)
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string keyword;
+		if (!(words >> keyword))
+			continue;
+
+		bool ok;
+		if (keyword == "name")
+			ok = (bool)(words >> script.name);
+		else if (keyword == "frames")
+			ok = words >> script.frames && script.frames > 0;
+		else if (keyword == "warmup")
+			ok = words >> script.warmup && script.warmup >= 0;
+		else if (keyword == "tick")
+			ok = words >> script.tickMs && script.tickMs >= 0.0f;
+		else if (keyword == "herd")
+			ok = words >> script.herd && script.herd > 0;
+		else if (keyword == "size")
+		{
+			std::string size;
+			ok = words >> size && sscanf(size.c_str(), "%dx%d", &script.width, &script.height) == 2 &&
+				 script.width > 0 && script.height > 0;
+		}
+		else if (keyword == "submit")
+			ok = (bool)(words >> script.submit);
+		else if (keyword == "layout")
+			ok = (bool)(words >> script.layout);
+		else if (keyword == "camera")
+		{
+			BenchCameraKey key;
+			ok = words >> key.frame >> key.rotation.x >> key.rotation.y >> key.rotation.z >> key.distance &&
+				 (script.camera.empty() || key.frame > script.camera.back().frame);
+			script.camera.push_back(key);
+		}
+		else if (keyword == "anim")
+		{
+			BenchAnimKey key;
+			ok = words >> key.frame >> key.rate && (script.anim.empty() || key.frame > script.anim.back().frame);
+			script.anim.push_back(key);
+		}
+		else
+			ok = false;
+
+		if (!ok)
+		{
+			std::cerr << path << ":" << number << ": cannot parse \"" << line << "\"" << std::endl;
+			return false;
+		}
+	}
+
+	// the original view when the script sets none
+	if (script.camera.empty())
+	{
+		BenchCameraKey key = {0, glm::vec3(4.123f, 6.25f, 4.375f), 4.0f};
+		script.camera.push_back(key);
+	}
+	return true;
+}
+
+void benchCamera(const BenchScript &script, int frame, glm::vec3 &rotation, float &distance)
+{
+	const std::vector<BenchCameraKey> &keys = script.camera;
+
+	size_t next = 0;
+	while (next < keys.size() && keys[next].frame <= frame)
+		next++;
+
+	if (next == 0 || next == keys.size())
+	{
+		const BenchCameraKey &key = keys[next == 0 ? 0 : keys.size() - 1];
+		rotation = key.rotation;
+		distance = key.distance;
+		return;
+	}
+
+	const BenchCameraKey &a = keys[next - 1], &b = keys[next];
+	float t = (float)(frame - a.frame) / (float)(b.frame - a.frame);
+	rotation = glm::mix(a.rotation, b.rotation, t);
+	distance = glm::mix(a.distance, b.distance, t);
+}
+
+float benchAnimTime(const BenchScript &script, int frame)
+{
+	// summed per frame, as a float would drift with the rate changes
+	double time = 0.0;
+	float rate = 1.0f;
+	size_t key = 0;
+	for (int f = 0; f < frame; f++)
+	{
+		while (key < script.anim.size() && script.anim[key].frame <= f)
+			rate = script.anim[key++].rate;
+		time += rate * script.tickMs;
+	}
+	return (float)time;
+}
+
+unsigned long long benchHash(const std::vector<unsigned char> &pixels)
+{
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t i = 0; i < pixels.size(); i++)
+		hash = (hash ^ pixels[i]) * 1099511628211ull;
+	return hash;
+}
+
+//----------------------------------------------------------------------------
+
+// Slower by less than this is timer noise whatever the percentage, e.g. on
+//   GPU times of a few microseconds
+static const double NoiseMs = 0.05;
+
+static void writePercentiles(std::ofstream &out, const char *name, const ProfilePercentiles &p, bool last)
+{
+	out << "  \"" << name << "\": {\"samples\": " << p.count << ", \"p50\": " << p.p50 << ", \"p95\": " << p.p95
+		<< ", \"p99\": " << p.p99 << "}" << (last ? "\n" : ",\n");
+}
+
+bool benchWriteJson(const char *path, const BenchScript &script, const BenchResult &result)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		std::cerr << "bench: cannot write " << path << std::endl;
+		return false;
+	}
+
+	char hash[32];
+	snprintf(hash, sizeof(hash), "%016llx", result.imageHash);
+
+	out << "{\n";
+	out << "  \"name\": \"" << script.name << "\",\n";
+	out << "  \"renderer\": \"" << result.renderer << "\",\n";
+	out << "  \"frames\": " << script.frames << ", \"warmup\": " << script.warmup << ", \"tick_ms\": "
+		<< script.tickMs << ",\n";
+	out << "  \"herd\": " << script.herd << ", \"width\": " << script.width << ", \"height\": " << script.height
+		<< ",\n";
+	out << "  \"submit\": \"" << script.submit << "\", \"layout\": \"" << script.layout << "\",\n";
+	out << "  \"image_hash\": \"" << hash << "\",\n";
+	writePercentiles(out, "frame_ms", result.frameMs, false);
+	writePercentiles(out, "cpu_ms", result.cpuMs, false);
+	writePercentiles(out, "gpu_ms", result.gpuMs, true);
+	out << "}\n";
+	return (bool)out;
+}
+
+// The number after "key": inside the object named object, from JSON this
+//   file wrote
+static bool findNumber(const std::string &text, const char *object, const char *key, double &value)
+{
+	size_t at = text.find(std::string("\"") + object + "\"");
+	if (at == std::string::npos)
+		return false;
+	at = text.find(std::string("\"") + key + "\":", at);
+	if (at == std::string::npos)
+		return false;
+	value = atof(text.c_str() + at + strlen(key) + 3);
+	return true;
+}
+
+bool benchCompare(const char *baselinePath, const BenchResult &result, double thresholdPercent, std::ostream &os)
+{
+	std::ifstream in(baselinePath);
+	if (!in)
+	{
+		os << "bench: no baseline " << baselinePath << std::endl;
+		return true;
+	}
+	std::stringstream text;
+	text << in.rdbuf();
+
+	struct Metric
+	{
+		const char *object, *key;
+		double value;
+	};
+	const Metric metrics[] = {
+		{"cpu_ms", "p50", result.cpuMs.p50}, {"cpu_ms", "p95", result.cpuMs.p95},
+		{"gpu_ms", "p50", result.gpuMs.p50}, {"gpu_ms", "p95", result.gpuMs.p95},
+	};
+
+	bool passed = true;
+	os << "bench: against " << baselinePath << ", threshold " << thresholdPercent << "%" << std::endl;
+	for (size_t i = 0; i < sizeof(metrics) / sizeof(metrics[0]); i++)
+	{
+		const Metric &m = metrics[i];
+		double baseline;
+		if (!findNumber(text.str(), m.object, m.key, baseline) || baseline <= 0.0)
+			continue;
+
+		double change = (m.value - baseline) / baseline * 100.0;
+		bool regressed = change > thresholdPercent && m.value - baseline > NoiseMs;
+		passed = passed && !regressed;
+		os << "  " << m.object << " " << m.key << "\t" << baseline << "\t-> " << m.value << "\t" << (change >= 0 ? "+" : "")
+		   << change << "%" << (regressed ? "\tREGRESSED" : "") << std::endl;
+	}
+
+	// other drivers rasterize differently, so only the same renderer's image
+	//   must match; strings are looked for verbatim
+	char hash[64];
+	snprintf(hash, sizeof(hash), "\"image_hash\": \"%016llx\"", result.imageHash);
+	if (text.str().find("\"renderer\": \"" + result.renderer + "\"") == std::string::npos)
+		os << "  baseline is from another renderer, images not compared" << std::endl;
+	else if (text.str().find(hash) == std::string::npos)
+	{
+		os << "  last frame differs from the baseline's" << std::endl;
+		passed = false;
+	}
+
+	os << "bench: " << (passed ? "passed" : "FAILED") << std::endl;
+	return passed;
+}
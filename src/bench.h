@@ -0,0 +1,91 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "profiler.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Scripted benchmarks ---
+//
+//   A script fixes everything a run depends on, so two runs of it draw the
+//     same frames: the herd, the frame size, how parts are submitted, and a
+//     timeline of camera and animation keys.  Time is simulated, tickMs per
+//     frame, never read from the clock.  One statement per line, # comments:
+//
+//     name    orbit              results are reported under this name
+//     frames  300                frames measured, after
+//     warmup  20                   frames drawn first and not measured
+//     tick    20                 simulated ms per frame
+//     herd    64
+//     size    640x480
+//     submit  instanced          any submit mode name
+//     layout  flat               any cube layout name
+//     camera  0 4.123 6.25 4.375 4
+//             frame, world rotation x y z in radians, eye distance;
+//             linear between keys, held before the first and after the last
+//     anim    100 0.5            from frame on the walk cycle runs at 0.5x;
+//                                  0 pauses it
+//
+//   A run is written as JSON: the script settings, the renderer, p50/p95/p99
+//     of frame, CPU and GPU time from the profiler, and a hash of the last
+//     frame.  Against a baseline written the same way, a CPU or GPU p50 or
+//     p95 more than the threshold percent slower fails, and so does a
+//     different last frame if the baseline ran on the same renderer.
+//
+
+struct BenchCameraKey
+{
+	int frame;
+	glm::vec3 rotation;
+	float distance;
+};
+
+struct BenchAnimKey
+{
+	int frame;
+	float rate;
+};
+
+struct BenchScript
+{
+	std::string name;
+	int frames, warmup;
+	float tickMs;
+	int herd, width, height;
+	std::string submit, layout;
+	std::vector<BenchCameraKey> camera; // ordered by frame
+	std::vector<BenchAnimKey> anim;
+};
+
+struct BenchResult
+{
+	std::string renderer;
+	ProfilePercentiles frameMs, cpuMs, gpuMs;
+	unsigned long long imageHash; // FNV-1a of the last frame's pixels
+};
+
+// Read a script; reports the line of any error
+bool benchLoadScript(const char *path, BenchScript &script);
+
+// Camera and animation time of frame, counted from the first warm-up frame
+void benchCamera(const BenchScript &script, int frame, glm::vec3 &rotation, float &distance);
+float benchAnimTime(const BenchScript &script, int frame);
+
+unsigned long long benchHash(const std::vector<unsigned char> &pixels);
+
+bool benchWriteJson(const char *path, const BenchScript &script, const BenchResult &result);
+
+// Print each metric next to the baseline's; false if any regressed by more
+//   than thresholdPercent or the image differs
+bool benchCompare(const char *baselinePath, const BenchResult &result, double thresholdPercent, std::ostream &os);
+
+#endif // _BENCH_H_
@@ -0,0 +1,48 @@
+//
+// Camera uniform block shared by every program
+//
+
+#include <cstring>
+
+#include "camera.h"
+#include "glstate.h"
+#include "reflect.h"
+
+static GLuint cameraBuffer;
+static CameraBlock uploaded; // what the buffer holds
+static bool uploadedValid = false;
+
+//----------------------------------------------------------------------------
+
+void cameraInit()
+{
+	glGenBuffers(1, &cameraBuffer);
+	stateBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+	stateBindBufferBase(GL_UNIFORM_BUFFER, CameraBinding, cameraBuffer);
+}
+
+void cameraBindProgram(GLuint program)
+{
+	GLuint index = reflectBlock(program, "Camera", sizeof(CameraBlock));
+	if (index != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, index, CameraBinding);
+}
+
+void cameraUpdate(const glm::mat4 &projection, const glm::mat4 &view)
+{
+	CameraBlock block;
+	block.projection = projection;
+	block.view = view;
+	block.viewProj = projection * view;
+
+	// a camera that has not moved needs no upload
+	if (!stateCount(STATE_BLOCK_DATA, uploadedValid && memcmp(&block, &uploaded, sizeof(block)) == 0))
+		return;
+	uploaded = block;
+	uploadedValid = true;
+
+	// the struct is the block, byte for byte
+	stateBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+}
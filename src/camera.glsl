@@ -0,0 +1,8 @@
+// Camera uniform block, bound to CameraBinding by cameraBindProgram()
+
+layout(std140) uniform Camera
+{
+  mat4 mProjection;
+  mat4 mView;
+  mat4 mViewProj;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _CAMERA_H_
+#define _CAMERA_H_
+
+#include "cube.h"
+#include "std140.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Camera uniform block ---
+//
+//   Projection and view live in one std140 block shared by every program,
+//     uploaded once per frame to binding point CameraBinding.  Draws then
+//     only supply model matrices.
+//
+
+const GLuint CameraBinding = 0;
+
+// layout(std140) uniform Camera in camera.glsl
+struct CameraBlock
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::mat4 viewProj; // projection * view
+};
+
+typedef Std140Layout<glm::mat4, glm::mat4, glm::mat4> CameraLayout;
+STD140_MEMBER(CameraBlock, CameraLayout, 0, projection);
+STD140_MEMBER(CameraBlock, CameraLayout, 1, view);
+STD140_MEMBER(CameraBlock, CameraLayout, 2, viewProj);
+STD140_SIZE(CameraBlock, CameraLayout);
+
+// Create the block's buffer and bind it to CameraBinding
+void cameraInit();
+
+// Point a program's Camera block, if it has one, at CameraBinding
+void cameraBindProgram(GLuint program);
+
+// Upload this frame's camera
+void cameraUpdate(const glm::mat4 &projection, const glm::mat4 &view);
+
+#endif // _CAMERA_H_
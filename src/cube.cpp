@@ -5,7 +5,33 @@
 //   those colors across the triangles.  We us an orthographic projection
 //   as the default projetion.
 
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "bake.h"
+#include "bench.h"
+#include "camera.h"
 #include "cube.h"
+#include "cubemesh.h"
+#include "drawlist.h"
+#include "glstate.h"
+#include "gpurig.h"
+#include "headless.h"
+#include "herd.h"
+#include "jobs.h"
+#include "merged.h"
+#include "mat4batch.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "reflect.h"
+#include "rig.h"
+#include "ringbuffer.h"
+#include "scheduler.h"
+#include "shaders.h"
+#include "skinned.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/transform.hpp"
@@ -13,316 +39,432 @@
 glm::mat4 projectMat;
 glm::mat4 viewMat;
 
-GLuint pvmMatrixID;
+GLuint program;
+GLuint vaos[NumCubeLayouts];
+UniformHandle<glm::mat4> modelMatrix;
+
+// layout(std140) uniform Part in vshader_ubo.glsl
+struct PartBlock
+{
+	glm::mat4 model;
+};
+
+typedef Std140Layout<glm::mat4> PartLayout;
+STD140_MEMBER(PartBlock, PartLayout, 0, model);
+STD140_SIZE(PartBlock, PartLayout);
+
+const GLuint PartBinding = 1;
+
+GLuint uboProgram;
+GLuint uboVaos[NumCubeLayouts];
+GLsizeiptr uboStride; // PartBlock rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+// per-frame matrices for the ubo and instanced paths
+RingBuffer frameRing;
+
+// part draws of the sorted path, recorded every frame by the job threads
+//   and merged into one list
+std::vector<DrawRecorder> drawRecorders;
+DrawList drawList;
 
 float rotAngleWorldx = 4.123f;
 float rotAngleWorldy = 6.25f;
 float rotAngleWorldz = 4.375f;
 
-float rotAngleLeg = 0.0f;
+float animTime = 0.0f; // walk cycle clock in ms
+bool headless = false;
+bool headlessPaced = false; // headless frames follow the scheduler, not a fixed 20 ms
+const char *profilePath = NULL;
 int isDrawingCar = false;
 
-typedef glm::vec4 color4;
-typedef glm::vec4 point4;
-
-const int NumVertices = 36; //(6 faces)(2 triangles/face)(3 vertices/triangle)
-
-point4 points[NumVertices];
-color4 colors[NumVertices];
-
-// Vertices of a unit cube centered at origin, sides aligned with axes
-point4 vertices[8] = {
-	point4(-0.5, -0.5, 0.5, 1.0),
-	point4(-0.5, 0.5, 0.5, 1.0),
-	point4(0.5, 0.5, 0.5, 1.0),
-	point4(0.5, -0.5, 0.5, 1.0),
-	point4(-0.5, -0.5, -0.5, 1.0),
-	point4(-0.5, 0.5, -0.5, 1.0),
-	point4(0.5, 0.5, -0.5, 1.0),
-	point4(0.5, -0.5, -0.5, 1.0)};
-
-// RGBA colors
-color4 vertex_colors[8] = {
-	color4(0.0, 0.0, 0.0, 1.0), // black
-	color4(0.0, 1.0, 1.0, 1.0), // cyan
-	color4(1.0, 0.0, 1.0, 1.0), // magenta
-	color4(1.0, 1.0, 0.0, 1.0), // yellow
-	color4(1.0, 0.0, 0.0, 1.0), // red
-	color4(0.0, 1.0, 0.0, 1.0), // green
-	color4(0.0, 0.0, 1.0, 1.0), // blue
-	color4(1.0, 1.0, 1.0, 1.0)	// white
-};
-
-//----------------------------------------------------------------------------
-
-// quad generates two triangles for each face and assigns colors
-//    to the vertices
-int Index = 0;
-void quad(int a, int b, int c, int d)
+// Create a vertex array object per cube layout feeding it to a program
+void makeCubeVaos(GLuint prog, GLuint *cubeVaos)
 {
-	colors[Index] = vertex_colors[a];
-	points[Index] = vertices[a];
-	Index++;
-	colors[Index] = vertex_colors[b];
-	points[Index] = vertices[b];
-	Index++;
-	colors[Index] = vertex_colors[c];
-	points[Index] = vertices[c];
-	Index++;
-	colors[Index] = vertex_colors[a];
-	points[Index] = vertices[a];
-	Index++;
-	colors[Index] = vertex_colors[c];
-	points[Index] = vertices[c];
-	Index++;
-	colors[Index] = vertex_colors[d];
-	points[Index] = vertices[d];
-	Index++;
+	glGenVertexArrays(NumCubeLayouts, cubeVaos);
+	for (int l = 0; l < NumCubeLayouts; l++)
+	{
+		stateBindVertexArray(cubeVaos[l]);
+		cubeMeshAttribs((CubeLayout)l, prog);
+	}
+	stateBindVertexArray(0);
 }
 
-//----------------------------------------------------------------------------
+// Uniforms and bindings of the two part programs, again after every reload
+void setupProgram()
+{
+	modelMatrix = reflectUniform<glm::mat4>(program, "mModel");
+	cubeMeshBindProgram(program);
+	cameraBindProgram(program);
+}
 
-// generate 12 triangles: 36 vertices and 36 colors
-void colorcube()
+void setupUboProgram()
 {
-	quad(1, 0, 3, 2);
-	quad(2, 3, 7, 6);
-	quad(3, 0, 4, 7);
-	quad(6, 5, 1, 2);
-	quad(4, 5, 6, 7);
-	quad(5, 4, 0, 1);
+	glUniformBlockBinding(uboProgram, reflectBlock(uboProgram, "Part", sizeof(PartBlock)), PartBinding);
+	cubeMeshBindProgram(uboProgram);
+	cameraBindProgram(uboProgram);
 }
 
-//----------------------------------------------------------------------------
+// Worker context for the shader builds, where the driver cannot compile in
+//   parallel itself
+ShaderWorkerFactory workerContextFactory()
+{
+	return headless ? headlessWorkerContext : NULL;
+}
 
 // OpenGL initialization
 void init()
 {
-	colorcube();
-
-	// Create a vertex array object
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	// Create and initialize a buffer object
-	GLuint buffer;
-	glGenBuffers(1, &buffer);
-	glBindBuffer(GL_ARRAY_BUFFER, buffer);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(points) + sizeof(colors),
-				 NULL, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(points), points);
-	glBufferSubData(GL_ARRAY_BUFFER, sizeof(points), sizeof(colors), colors);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	stateReset();
+
+	// start every program first; they compile while the meshes and tables
+	//   below are built, and each InitShader() picks its own up
+	static const char *vertexShaders[] = {
+		"src/vshader.glsl", "src/vshader_ubo.glsl", "src/vshader_herd.glsl", "src/vshader_baked.glsl",
+		"src/vshader_rig.glsl", "src/vshader_merged.glsl", "src/vshader_skinned.glsl"};
+	shaderInit(workerContextFactory());
+	for (size_t i = 0; i < sizeof(vertexShaders) / sizeof(vertexShaders[0]); i++)
+		shaderPrefetch(vertexShaders[i], "src/fshader.glsl");
+	if (HasGLExtension("GL_ARB_shader_draw_parameters"))
+		shaderPrefetch("src/vshader_herd.glsl", "src/fshader.glsl", "MODEL_FROM_DRAW_ID");
+
+	cubeMeshInit();
 
 	// Load shaders and use the resulting shader program
-	GLuint program = InitShader("src/vshader.glsl", "src/fshader.glsl");
-	glUseProgram(program);
+	program = InitShader("src/vshader.glsl", "src/fshader.glsl");
+	makeCubeVaos(program, vaos);
+	setupProgram();
+	shaderWatch(program, setupProgram);
+
+	// same cube, matrix read from a uniform block range
+	uboProgram = InitShader("src/vshader_ubo.glsl", "src/fshader.glsl");
+	makeCubeVaos(uboProgram, uboVaos);
+	setupUboProgram();
+	shaderWatch(uboProgram, setupUboProgram);
 
-	// set up vertex arrays
-	GLuint vPosition = glGetAttribLocation(program, "vPosition");
-	glEnableVertexAttribArray(vPosition);
-	glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0,
-						  BUFFER_OFFSET(0));
+	GLint uboAlign;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlign);
+	uboStride = ((GLsizeiptr)sizeof(PartBlock) + uboAlign - 1) / uboAlign * uboAlign;
 
-	GLuint vColor = glGetAttribLocation(program, "vColor");
-	glEnableVertexAttribArray(vColor);
-	glVertexAttribPointer(vColor, 4, GL_FLOAT, GL_FALSE, 0,
-						  BUFFER_OFFSET(sizeof(points)));
+	cameraInit();
 
-	pvmMatrixID = glGetUniformLocation(program, "mPVM");
+	herdInit();
+	bakeInit();
+	gpuRigInit();
+	mergedInit();
+	skinnedInit();
+
+	// without it the ring paths draw nothing, every other one still works
+	if (!ringInit(frameRing, 1 << 20))
+		std::cerr << "ring: no per-frame buffer, the paths that write to it will not draw" << std::endl;
 
 	projectMat = glm::perspective(glm::radians(65.0f), 1.0f, 0.1f, 100.0f);
 	viewMat = glm::lookAt(glm::vec3(0, 0, 4), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 
 	glEnable(GL_DEPTH_TEST);
 	glClearColor(0.0, 0.0, 0.0, 1.0);
+
+	if (!submitModeSupported(submitMode))
+	{
+		std::cerr << submitModeName(submitMode) << " submission is not supported here, using instanced" << std::endl;
+		submitMode = SUBMIT_INSTANCED;
+	}
+
+	// the binds of setup are not part of any frame
+	stateFrameCounts = StateCounts();
+
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	programCacheReport(std::cout);
+	std::cout << "startup: " << elapsed.count() << " ms" << std::endl;
 }
 
-void drawLeg(glm::mat4 worldRotMat, glm::mat4 bodyMat)
+// One glUniformMatrix4fv + glDrawArrays per part, the upload skipped when
+//   a part has the matrix of the one before
+void drawUniformParts(const glm::mat4 &worldMat)
 {
-	glm::mat4 modelMat, pvmMat, scaleMat, identityMat = glm::mat4(1.0f);
-	glm::mat4 legMat;
-	glm::vec3 eachLegPos[4];
-
-	int eachLeglDir[4];
-	const float xPos = 0.6f, yPos = 0.4f, zPos = 0.4f;
-
-	eachLegPos[0] = glm::vec3(xPos, yPos, -zPos);	// rear right
-	eachLegPos[1] = glm::vec3(xPos, -yPos, -zPos);	// rear left
-	eachLegPos[2] = glm::vec3(-xPos, yPos, -zPos);	// front right
-	eachLegPos[3] = glm::vec3(-xPos, -yPos, -zPos); // front left
-	eachLeglDir[0] = 1;
-	eachLeglDir[1] = -1;
-	eachLeglDir[2] = -1;
-	eachLeglDir[3] = 1;
-
-	// 허벅지
-	for (int i = 0; i < 4; i++)
+	herdPartMats.resize((size_t)herdSize * NumRigModels);
+	{
+		ProfileScope scope(PROFILE_POSE);
+		herdCompose(worldMat, animTime, &herdPartMats[0]);
+	}
+
+	// uniform uploads are interleaved with the draws, so all of this
+	//   counts as submission
+	ProfileScope scope(PROFILE_SUBMIT);
+	stateUseProgram(program);
+	stateBindVertexArray(vaos[cubeLayout]);
+	for (size_t i = 0; i < herdPartMats.size(); i++)
+	{
+		uniformSet(modelMatrix, herdPartMats[i]);
+		cubeMeshDraw(1);
+	}
+}
+
+// Every part matrix in the frame ring, one glBindBufferRange per draw
+void drawUboParts(const glm::mat4 &worldMat)
+{
+	size_t count = (size_t)herdSize * NumRigModels;
+	GLsizeiptr size = count * uboStride;
+	GLintptr offset;
+
+	herdPartMats.resize(count);
+	{
+		ProfileScope scope(PROFILE_POSE);
+		herdCompose(worldMat, animTime, &herdPartMats[0]);
+	}
+
+	unsigned char *dst;
 	{
-		// 허벅지
-		legMat = glm::translate(identityMat, eachLegPos[i]);
-		legMat = glm::translate(legMat, glm::vec3(0.0f, 0.0f, 0.5f)); // 상단 끝 부분을 회전 축으로 이동
-		legMat = glm::rotate(legMat, -rotAngleLeg * 60.0f * eachLeglDir[i], glm::vec3(0, 1, 0));
-		legMat = glm::translate(legMat, glm::vec3(0.0f, 0.0f, -0.5f)); // 다시 원래 위치로 되돌리기
-		scaleMat = glm::scale(identityMat, glm::vec3(0.5, 0.5, 0.5));
-		pvmMat = projectMat * viewMat * worldRotMat * bodyMat * legMat * scaleMat;
-		glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-
-		// 무릎
-		modelMat = glm::translate(legMat, glm::vec3(0, 0, -0.25));
-		scaleMat = glm::scale(identityMat, glm::vec3(0.45, 0.375, 0.2));
-		pvmMat = projectMat * viewMat * worldRotMat * bodyMat * modelMat * scaleMat;
-		glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-
-		// 종아리
-		modelMat = glm::translate(modelMat, glm::vec3(0.0, 0.0, -0.31));
-		modelMat = glm::translate(modelMat, glm::vec3(0.0f, 0.0f, 0.5f)); // 상단 끝 부분을 회전 축으로 이동
-		modelMat = glm::rotate(modelMat, -rotAngleLeg * 50.0f * eachLeglDir[i], glm::vec3(0, 1, 0));
-		modelMat = glm::translate(modelMat, glm::vec3(0.0f, 0.0f, -0.5f)); // 다시 원래 위치로 되돌리기
-		scaleMat = glm::scale(identityMat, glm::vec3(0.35, 0.35, 0.5));
-		pvmMat = projectMat * viewMat * worldRotMat * bodyMat * modelMat * scaleMat;
-		glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-
-		// 발
-		modelMat = glm::translate(modelMat, glm::vec3(0.025, 0.0, -0.25));
-		modelMat = glm::rotate(modelMat, -rotAngleLeg * 75.0f * eachLeglDir[i], glm::vec3(0, 1, 0));
-		scaleMat = glm::scale(identityMat, glm::vec3(0.5, 0.36, 0.175));
-		pvmMat = projectMat * viewMat * worldRotMat * bodyMat * modelMat * scaleMat;
-		glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+		// spread out to the range alignment GL demands
+		ProfileScope scope(PROFILE_UPLOAD);
+		ringBeginFrame(frameRing, size);
+		dst = (unsigned char *)ringAlloc(frameRing, size, uboStride, offset);
+		for (size_t i = 0; i < count && dst; i++)
+			memcpy(dst + i * uboStride, &herdPartMats[i], sizeof(PartBlock));
+		ringFlush(frameRing);
 	}
+
+	// no ring memory this frame: nothing to draw
+	if (dst)
+	{
+		ProfileScope scope(PROFILE_SUBMIT);
+		stateUseProgram(uboProgram);
+		stateBindVertexArray(uboVaos[cubeLayout]);
+		for (size_t i = 0; i < count; i++)
+		{
+			stateBindBufferRange(GL_UNIFORM_BUFFER, PartBinding, frameRing.buffer, offset + i * uboStride,
+							  sizeof(PartBlock));
+			cubeMeshDraw(1);
+		}
+	}
+
+	ringEndFrame(frameRing);
 }
 
-void drawHead(glm::mat4 worldRotMat, glm::mat4 bodyMat)
+// Compose straight into the frame ring and draw the herd in one call
+void drawInstancedParts(const glm::mat4 &worldMat)
 {
-	glm::mat4 modelMat, pvmMat, scaleMat, identityMat = glm::mat4(1.0f);
-	glm::mat4 headMat, noseMat;
-
-	headMat = glm::translate(glm::mat4(1.0f), glm::vec3(0.25f, .0f, -0.2f));
-	headMat = glm::rotate(headMat, rotAngleLeg * 35.0f, glm::vec3(1.0f, 0.0f, 0.0f));
-
-	// 머리
-	modelMat = glm::translate(identityMat, glm::vec3(0.75, 0, 0.45));
-	modelMat = glm::rotate(modelMat, -0.25f, glm::vec3(0, 1, 0));
-	scaleMat = glm::scale(identityMat, glm::vec3(0.65, 0.6, 0.65));
-	pvmMat = projectMat * viewMat * worldRotMat * bodyMat * headMat * modelMat * scaleMat;
-	glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-	glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-
-	// 귀
-	for (int i = 0; i < 2; i++)
+	int count = herdSize * NumRigModels;
+	GLsizeiptr size = count * sizeof(glm::mat4);
+	GLintptr offset;
+
+	glm::mat4 *dst;
 	{
-		int sign = i == 0 ? 1 : -1;
-		modelMat = glm::translate(identityMat, glm::vec3(0.7, 0.5 * sign, 0.45));
-		modelMat = glm::rotate(modelMat, -0.25f, glm::vec3(1 * sign, 1, -1 * sign));
-		scaleMat = glm::scale(identityMat, glm::vec3(0.125, 0.65, 0.65));
-		pvmMat = projectMat * viewMat * worldRotMat * bodyMat * headMat * modelMat * scaleMat;
-		glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+		// the ring is GL memory, so there is no separate upload step
+		ProfileScope scope(PROFILE_POSE);
+		ringBeginFrame(frameRing, size);
+		dst = (glm::mat4 *)ringAlloc(frameRing, size, sizeof(glm::mat4), offset);
+		if (dst)
+			herdCompose(worldMat, animTime, dst);
+		ringFlush(frameRing);
 	}
 
-	// 상아
-	for (int i = 0; i < 2; i++)
+	if (dst)
+		herdDraw(frameRing.buffer, offset, count);
+	ringEndFrame(frameRing);
+}
+
+// Compose into the frame ring and draw every part with one multi-draw, each
+//   draw fetching its matrix by gl_DrawIDARB; false if the matrices are too
+//   many for a texture buffer
+bool drawMultiDrawParts(const glm::mat4 &worldMat)
+{
+	int count = herdSize * NumRigModels;
+	GLsizeiptr size = count * sizeof(glm::mat4);
+	GLintptr offset;
+
+	glm::mat4 *dst;
 	{
-		int sign = i == 0 ? 1 : -1;
-		modelMat = glm::translate(identityMat, glm::vec3(0.8, 0.275 * sign, 0.0));
-		modelMat = glm::rotate(modelMat, -.35f, glm::vec3(-1 * sign, 1, -1 * sign));
-		scaleMat = glm::scale(identityMat, glm::vec3(0.1, 0.1, 0.65));
-		pvmMat = projectMat * viewMat * worldRotMat * bodyMat * headMat * modelMat * scaleMat;
-		glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-		glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+		ProfileScope scope(PROFILE_POSE);
+		ringBeginFrame(frameRing, size);
+		dst = (glm::mat4 *)ringAlloc(frameRing, size, sizeof(glm::mat4), offset);
+		if (dst)
+			herdCompose(worldMat, animTime, dst);
+		ringFlush(frameRing);
 	}
 
-	// 코1
-	noseMat = glm::translate(identityMat, glm::vec3(0.85, 0, 0.0));
-	// noseMat = glm::rotate(noseMat, 0, glm::vec3(0, 1, 0));
-	noseMat = glm::rotate(noseMat, -rotAngleLeg * 35.0f, glm::vec3(0, 0, 1));
-	scaleMat = glm::scale(identityMat, glm::vec3(0.45, 0.45, 0.65));
-	pvmMat = projectMat * viewMat * worldRotMat * bodyMat * headMat * noseMat * scaleMat;
-	glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-	glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-
-	// 코2
-	noseMat = glm::translate(noseMat, glm::vec3(0, 0, -0.5));
-	noseMat = glm::rotate(noseMat, 0.1f, glm::vec3(0, 1, 0));
-	noseMat = glm::rotate(noseMat, -rotAngleLeg * 35.0f, glm::vec3(0, 0, 1));
-	scaleMat = glm::scale(identityMat, glm::vec3(0.35, 0.35, 0.45));
-	pvmMat = projectMat * viewMat * worldRotMat * bodyMat * headMat * noseMat * scaleMat;
-	glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-	glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-
-	// 코3
-	noseMat = glm::translate(noseMat, glm::vec3(0, 0, -0.3));
-	noseMat = glm::rotate(noseMat, 0.15f, glm::vec3(0, 1, 0));
-	noseMat = glm::rotate(noseMat, -rotAngleLeg * 35.0f, glm::vec3(0, 0, 1));
-	scaleMat = glm::scale(identityMat, glm::vec3(0.225, 0.225, 0.4));
-	pvmMat = projectMat * viewMat * worldRotMat * bodyMat * headMat * noseMat * scaleMat;
-	glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-	glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+	bool drawn = !dst || herdMultiDraw(frameRing, offset, count);
+	ringEndFrame(frameRing);
+	return drawn;
 }
 
-void drawBody(glm::mat4 worldRotMat, glm::mat4 bodyMat)
+// As instanced, plus one indirect command per part in the ring, drawn with
+//   one glMultiDraw*Indirect
+void drawIndirectParts(const glm::mat4 &worldMat)
 {
-	glm::mat4 modelMat, pvmMat, scaleMat, identityMat = glm::mat4(1.0f);
-
-	// 몸통
-	scaleMat = glm::scale(identityMat, glm::vec3(1.4, 1, 0.9));
-	pvmMat = projectMat * viewMat * worldRotMat * bodyMat * scaleMat;
-	glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-	glDrawArrays(GL_TRIANGLES, 0, NumVertices);
-
-	// 꼬리
-	modelMat = glm::translate(identityMat, glm::vec3(-0.8, 0, 0));
-	modelMat = glm::rotate(modelMat, 0.35f, glm::vec3(0, 1, 0));
-	scaleMat = glm::scale(identityMat, glm::vec3(0.1, 0.1, 0.75));
-	pvmMat = projectMat * viewMat * worldRotMat * bodyMat * modelMat * scaleMat;
-	glUniformMatrix4fv(pvmMatrixID, 1, GL_FALSE, &pvmMat[0][0]);
-	glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+	int count = herdSize * NumRigModels;
+	GLsizeiptr size = count * sizeof(glm::mat4), commandSize = count * cubeMeshIndirectStride();
+	GLintptr offset, commandOffset;
+
+	glm::mat4 *dst;
+	{
+		ProfileScope scope(PROFILE_POSE);
+		ringBeginFrame(frameRing, size + commandSize + sizeof(glm::mat4));
+		dst = (glm::mat4 *)ringAlloc(frameRing, size, sizeof(glm::mat4), offset);
+		if (dst)
+			herdCompose(worldMat, animTime, dst);
+	}
+
+	void *commands;
+	{
+		ProfileScope scope(PROFILE_UPLOAD);
+		commands = ringAlloc(frameRing, commandSize, sizeof(GLuint), commandOffset);
+		if (commands)
+			cubeMeshIndirectCommands(commands, count);
+		ringFlush(frameRing);
+	}
+
+	if (dst && commands)
+		herdDrawIndirect(frameRing.buffer, offset, commandOffset, count);
+	ringEndFrame(frameRing);
 }
 
-void drawElephant(glm::mat4 worldRotMat)
+// One command per part, keyed by state and view depth and recorded in
+//   parallel; after merging and sorting, each run of commands with the same
+//   state is one instanced draw of matrices copied to the ring in sorted
+//   order.  The herd program and the cube
+//   layout's VAO are the only state parts have so far, so program slot 0
+//   and no material: the sort orders them front to back for early-Z and
+//   the frame is a single run.
+void drawSortedParts(const glm::mat4 &worldMat)
 {
-	glm::mat4 bodyMat = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, 0));
-	bodyMat = glm::rotate(bodyMat, -rotAngleLeg * 10.0f, glm::vec3(1, 0, 0));
+	GLintptr offset;
+
+	{
+		ProfileScope scope(PROFILE_POSE);
+		herdRecord(worldMat, animTime, viewMat, drawKey(0, cubeLayout, 0, 0.0f), drawRecorders);
+	}
+
+	{
+		ProfileScope scope(PROFILE_SUBMIT);
+		drawListMerge(drawList, drawRecorders);
+		drawListSort(drawList);
+	}
+	size_t count = drawList.commands.size();
+
+	glm::mat4 *dst;
+	{
+		ProfileScope scope(PROFILE_UPLOAD);
+		ringBeginFrame(frameRing, count * sizeof(glm::mat4));
+		dst = (glm::mat4 *)ringAlloc(frameRing, count * sizeof(glm::mat4), sizeof(glm::mat4), offset);
+		for (size_t i = 0; i < count && dst; i++)
+			dst[i] = drawRecordedMatrix(drawRecorders, drawList.commands[i].payload);
+		ringFlush(frameRing);
+	}
 
-	drawBody(worldRotMat, bodyMat); // 몸통 그리기
-	drawHead(worldRotMat, bodyMat); // 머리 그리기
-	drawLeg(worldRotMat, bodyMat);	// 다리 그리기
+	for (size_t begin = 0, end; begin < count && dst; begin = end)
+	{
+		end = drawListRunEnd(drawList, begin);
+		herdDraw(frameRing.buffer, offset + begin * sizeof(glm::mat4), (int)(end - begin));
+	}
+	ringEndFrame(frameRing);
 }
 
 void display(void)
 {
-	glm::mat4 worldRotMat, pvmMat;
+	glm::mat4 worldRotMat;
+
+	shaderPoll();
+
+	profilerBeginFrame();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	worldRotMat = glm::rotate(glm::mat4(1.0f), rotAngleWorldx, glm::vec3(1.0f, 0.0f, 0.0f));
 	worldRotMat *= glm::rotate(glm::mat4(1.0f), rotAngleWorldy, glm::vec3(0.0f, 1.0f, 0.0f));
 	worldRotMat *= glm::rotate(glm::mat4(1.0f), rotAngleWorldz, glm::vec3(0.0f, 0.0f, 1.0f));
 
-	drawElephant(worldRotMat);
+	{
+		// projection and view reach every program through the Camera block,
+		//   so the per-part matrices below are model matrices only
+		ProfileScope scope(PROFILE_UPLOAD);
+		cameraUpdate(projectMat, viewMat);
+	}
+
+	// the paths that read the ring through a texture buffer run out of texels
+	//   for big enough herds; from then on the herd is drawn instanced
+	bool drawn = true;
 
-	glutSwapBuffers();
+	// the pose math runs on the job workers or on the GPU; this thread waits
+	//   for it without taking any of it on, and submits
+	switch (submitMode)
+	{
+	case SUBMIT_UNIFORM:
+		drawUniformParts(worldRotMat);
+		break;
+	case SUBMIT_UBO:
+		drawUboParts(worldRotMat);
+		break;
+	case SUBMIT_INSTANCED:
+		drawInstancedParts(worldRotMat);
+		break;
+	case SUBMIT_BAKED:
+		bakeDraw(worldRotMat, animTime);
+		break;
+	case SUBMIT_GPURIG:
+		gpuRigDraw(worldRotMat, animTime);
+		break;
+	case SUBMIT_MERGED:
+		drawn = mergedDraw(frameRing, worldRotMat, animTime);
+		break;
+	case SUBMIT_SKINNED:
+		drawn = skinnedDraw(frameRing, worldRotMat, animTime);
+		break;
+	case SUBMIT_SORTED:
+		drawSortedParts(worldRotMat);
+		break;
+	case SUBMIT_MULTIDRAW:
+		drawn = drawMultiDrawParts(worldRotMat);
+		break;
+	default:
+		drawIndirectParts(worldRotMat);
+		break;
+	}
+
+	if (!drawn)
+	{
+		std::cerr << submitModeName(submitMode) << " submission of " << herdSize
+				  << " elephants needs a bigger texture buffer than GL allows, using instanced" << std::endl;
+		submitMode = SUBMIT_INSTANCED;
+		drawInstancedParts(worldRotMat);
+	}
+
+	profilerEndFrame();
+	stateEndFrame();
+
+	// headless frames stay in the framebuffer object for readback
+	if (!headless)
+		glutSwapBuffers();
 }
 
 //----------------------------------------------------------------------------
+// Sleeps until the scheduler says the next frame is due, so the process no
+//   longer spins while waiting
 void idle()
 {
-	static int prevTime = glutGet(GLUT_ELAPSED_TIME);
-	int currTime = glutGet(GLUT_ELAPSED_TIME);
+	animTime = schedulerNextFrame();
+	glutPostRedisplay();
+}
+
+//----------------------------------------------------------------------------
+void printHerdMode()
+{
+	std::cout << "herd: " << herdSize << " elephants, " << submitModeName(submitMode) << " submission, "
+			  << cubeLayoutName(cubeLayout) << " cubes" << std::endl;
+}
 
-	if (abs(currTime - prevTime) >= 20)
-	{
-		rotAngleLeg = glm::radians(cos(currTime / 100.0f) * 360.0f / 2000.0f);
+// Print the frame time summary and write the per-frame report, if requested
+void finishProfile()
+{
+	if (!profilerEnabled)
+		return;
 
-		prevTime = currTime;
-		glutPostRedisplay();
-	}
+	profilerFinish();
+	profilerPrintSummary(std::cout);
+	std::cout << "  ring  " << frameRing.waits << " frames waited on a fence" << std::endl;
+	if (profilePath)
+		profilerWrite(profilePath);
 }
 
-//----------------------------------------------------------------------------
 void keyboard(unsigned char key, int x, int y)
 {
 	switch (key)
@@ -336,9 +478,48 @@ void keyboard(unsigned char key, int x, int y)
 	case '3':
 		rotAngleWorldz += 0.125f;
 		break;
+	case 'i': // cycle how part matrices are submitted
+		do
+			submitMode = (SubmitMode)((submitMode + 1) % NumSubmitModes);
+		while (!submitModeSupported(submitMode));
+		printHerdMode();
+		break;
+	case '+': // double the herd
+		if (herdSize < 65536)
+			herdPlace(herdSize * 2);
+		printHerdMode();
+		break;
+	case '-': // halve the herd
+		if (herdSize > 1)
+			herdPlace(herdSize / 2);
+		printHerdMode();
+		break;
+	case 'l': // cycle the cube vertex layout
+		cubeMeshSelect((CubeLayout)((cubeLayout + 1) % NumCubeLayouts));
+		printHerdMode();
+		break;
+	case 'k': // cycle the matrix batch kernel
+		do
+			mat4Isa = (Mat4Isa)((mat4Isa + 1) % NumMat4Isas);
+		while (!mat4IsaSupported(mat4Isa));
+		std::cout << "matrix kernel: " << mat4IsaName(mat4Isa) << std::endl;
+		break;
+	case 'p': // frame time summary so far
+		if (profilerEnabled)
+			profilerPrintSummary(std::cout);
+		schedulerReport(std::cout);
+		stateReport(std::cout);
+		break;
+	case 'v': // cycle frame pacing
+		schedulerSetMode((PaceMode)((paceMode + 1) % NumPaceModes));
+		std::cout << "pace: " << paceModeName(paceMode) << std::endl;
+		break;
 	case 033: // Escape key
 	case 'q':
 	case 'Q':
+		schedulerReport(std::cout);
+		stateReport(std::cout);
+		finishProfile();
 		exit(EXIT_SUCCESS);
 		break;
 	}
@@ -346,30 +527,509 @@ void keyboard(unsigned char key, int x, int y)
 
 //----------------------------------------------------------------------------
 
-void resize(int w, int h)
+void reshape(int w, int h)
 {
 	float ratio = (float)w / (float)h;
 	glViewport(0, 0, w, h);
 
 	projectMat = glm::perspective(glm::radians(65.0f), ratio, 0.1f, 100.0f);
+}
 
+void resize(int w, int h)
+{
+	reshape(w, h);
 	glutPostRedisplay();
 }
 
 //----------------------------------------------------------------------------
 
+// A -dump pattern is a printf format given one int: it must hold exactly
+//   one %d, optionally with a width such as %04d, and no other conversion
+bool dumpPatternValid(const char *pattern)
+{
+	int conversions = 0;
+	for (const char *c = pattern; *c; c++)
+	{
+		if (*c != '%')
+			continue;
+		if (c[1] == '%')
+		{
+			c++;
+			continue;
+		}
+		c++;
+		while (isdigit((unsigned char)*c))
+			c++;
+		if (*c != 'd')
+			return false;
+		conversions++;
+	}
+	return conversions == 1;
+}
+
+// Render frames without a window, advancing the animation by one 20 ms
+//   simulation tick per frame, or in real time with -pace, and optionally
+//   dump every frame to a numbered PPM file
+int runHeadless(int frames, int width, int height, const char *dumpPattern)
+{
+	headless = true;
+	if (!headlessInit(width, height))
+		return EXIT_FAILURE;
+
+	init();
+	reshape(width, height);
+	profilerInit();
+	if (headlessPaced)
+		schedulerInit();
+
+	std::vector<unsigned char> rgb;
+	double totalMs = 0.0, minMs = 1.0e9, maxMs = 0.0;
+
+	for (int f = 0; f < frames; f++)
+	{
+		animTime = headlessPaced ? schedulerNextFrame() : f * (float)SimTickMs;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		display();
+		glFinish(); // count the GPU work of this frame too
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		totalMs += elapsed.count();
+		minMs = glm::min(minMs, elapsed.count());
+		maxMs = glm::max(maxMs, elapsed.count());
+
+		if (dumpPattern)
+		{
+			char path[1024];
+			snprintf(path, sizeof(path), dumpPattern, f);
+			headlessReadFrame(rgb);
+			if (!headlessWritePPM(path, rgb))
+				return EXIT_FAILURE;
+		}
+	}
+
+	if (frames > 0)
+	{
+		std::cout << "headless: " << frames << " frames at " << width << "x" << height << ", " << herdSize
+				  << " elephants, " << submitModeName(submitMode) << " submission, " << cubeLayoutName(cubeLayout)
+				  << " cubes" << std::endl;
+		std::cout << "headless: " << totalMs / frames << " ms/frame avg, " << minMs << " min, " << maxMs
+				  << " max, " << frames * 1000.0 / totalMs << " fps" << std::endl;
+	}
+
+	if (headlessPaced)
+		schedulerReport(std::cout);
+	stateReport(std::cout);
+	finishProfile();
+	shaderShutdown();
+	headlessShutdown();
+	return EXIT_SUCCESS;
+}
+
+// Draw the same frames with every cube layout, reporting the time per frame
+//   and checking each image against the flat layout
+int runMeshBenchmark(int frames, int width, int height)
+{
+	headless = true;
+	if (!headlessInit(width, height))
+		return EXIT_FAILURE;
+
+	init();
+	reshape(width, height);
+
+	GLuint timer;
+	glGenQueries(1, &timer);
+
+	std::vector<unsigned char> reference, rgb;
+	size_t cubes = (size_t)herdSize * NumRigModels;
+
+	std::cout << "cube layout benchmark: " << herdSize << " elephants (" << cubes << " cubes), " << frames
+			  << " frames at " << width << "x" << height << ", " << submitModeName(submitMode) << " submission"
+			  << std::endl;
+	std::cout << "layout\tbytes/vertex\tbytes/cube\tvertex MB/frame\tms/frame\tgpu ms/frame\tmax diff" << std::endl;
+
+	for (int l = 0; l < NumCubeLayouts; l++)
+	{
+		cubeMeshSelect((CubeLayout)l);
+
+		animTime = 0.0f;
+		display(); // warm up
+		glFinish();
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		glBeginQuery(GL_TIME_ELAPSED, timer);
+		for (int f = 0; f < frames; f++)
+		{
+			animTime = f * 20.0f;
+			display();
+		}
+		glEndQuery(GL_TIME_ELAPSED);
+		glFinish();
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		GLuint64 gpuNs = 0;
+		glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &gpuNs);
+
+		// the last frame, at the same time for every layout
+		headlessReadFrame(rgb);
+		if (l == 0)
+			reference = rgb;
+		int maxDiff = 0;
+		for (size_t i = 0; i < rgb.size(); i++)
+			maxDiff = glm::max(maxDiff, abs(rgb[i] - reference[i]));
+
+		std::cout << cubeLayoutName((CubeLayout)l) << "\t" << cubeMeshVertexSize((CubeLayout)l) << "\t"
+				  << cubeMeshBytes((CubeLayout)l) << "\t" << cubes * cubeMeshBytes((CubeLayout)l) / 1.0e6 << "\t"
+				  << elapsed.count() / frames << "\t" << gpuNs / 1.0e6 / frames << "\t" << maxDiff << std::endl;
+	}
+
+	glDeleteQueries(1, &timer);
+	shaderShutdown();
+	headlessShutdown();
+	return EXIT_SUCCESS;
+}
+
+// Draw the same frames of each herd size with every way of submitting the
+//   parts one by one or all at once, as tab-separated CPU time in the submit
+//   phase alone and in all of display(), GPU time and frames per second.
+//   The last frame of each must match the uniform path's within
+//   SubmitBenchTolerance per channel.
+int runSubmitBenchmark(int frames, int width, int height, const std::vector<int> &herdSizes)
+{
+	static const SubmitMode modes[] = {SUBMIT_UNIFORM, SUBMIT_UBO, SUBMIT_MULTIDRAW, SUBMIT_INSTANCED,
+									   SUBMIT_INDIRECT};
+	const int SubmitBenchTolerance = 2;
+
+	headless = true;
+	if (!headlessInit(width, height))
+		return EXIT_FAILURE;
+
+	init();
+	reshape(width, height);
+
+	// the submit phase of each frame, apart from posing and uploads
+	profilerEnabled = true;
+	profilerInit();
+
+	GLuint timer;
+	glGenQueries(1, &timer);
+
+	std::vector<unsigned char> reference, rgb;
+	bool matched = true;
+
+	std::cout << "submission benchmark: " << frames << " frames at " << width << "x" << height << ", "
+			  << cubeLayoutName(cubeLayout) << " cubes" << std::endl;
+	std::cout << "elephants\tsubmission\tdraws\tsubmit ms p50\tdisplay ms/frame\tgpu ms/frame\tfps\tmax diff\timage"
+			  << std::endl;
+
+	for (size_t h = 0; h < herdSizes.size(); h++)
+	{
+		herdPlace(herdSizes[h]);
+
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+		{
+			submitMode = modes[m];
+			std::cout << herdSize << "\t" << submitModeName(submitMode) << "\t";
+			if (!submitModeSupported(submitMode))
+			{
+				std::cout << "-\t-\t-\t-\t-\t-\tunsupported" << std::endl;
+				continue;
+			}
+
+			animTime = 0.0f;
+			display(); // warm up
+			glFinish();
+			if (submitMode != modes[m])
+			{
+				std::cout << "-\t-\t-\t-\t-\t-\ttoo big" << std::endl;
+				continue;
+			}
+			profilerClear();
+
+			double cpuMs = 0.0;
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			glBeginQuery(GL_TIME_ELAPSED, timer);
+			for (int f = 0; f < frames; f++)
+			{
+				animTime = f * (float)SimTickMs;
+				std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+				display();
+				std::chrono::duration<double, std::milli> frameCpu = std::chrono::steady_clock::now() - frameStart;
+				cpuMs += frameCpu.count();
+			}
+			glEndQuery(GL_TIME_ELAPSED);
+			glFinish();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+			GLuint64 gpuNs = 0;
+			glGetQueryObjectui64v(timer, GL_QUERY_RESULT, &gpuNs);
+
+			// the last frame, at the same time for every submission
+			headlessReadFrame(rgb);
+			if (m == 0)
+				reference = rgb;
+			int maxDiff = 0;
+			for (size_t i = 0; i < rgb.size(); i++)
+				maxDiff = glm::max(maxDiff, abs(rgb[i] - reference[i]));
+			matched = matched && maxDiff <= SubmitBenchTolerance;
+
+			int draws = submitMode == SUBMIT_INSTANCED ? 1 : herdSize * NumRigModels;
+			std::cout << draws << "\t" << profilerPhaseMs(PROFILE_SUBMIT).p50 << "\t" << cpuMs / frames << "\t"
+					  << gpuNs / 1.0e6 / frames << "\t"
+					  << frames * 1000.0 / elapsed.count() << "\t" << maxDiff << "\t"
+					  << (maxDiff <= SubmitBenchTolerance ? "ok" : "differs") << std::endl;
+		}
+	}
+
+	glDeleteQueries(1, &timer);
+	shaderShutdown();
+	headlessShutdown();
+	return matched ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Run a benchmark script: its warm-up frames, then its measured frames with
+//   the profiler on, written as JSON and checked against a baseline run of
+//   the same script
+int runBenchScript(const char *scriptPath, const char *jsonPath, const char *baselinePath, double thresholdPercent)
+{
+	BenchScript script;
+	if (!benchLoadScript(scriptPath, script))
+		return EXIT_FAILURE;
+
+	int mode = 0, layout = 0;
+	while (mode < NumSubmitModes && script.submit != submitModeName((SubmitMode)mode))
+		mode++;
+	while (layout < NumCubeLayouts && script.layout != cubeLayoutName((CubeLayout)layout))
+		layout++;
+	if (mode == NumSubmitModes || layout == NumCubeLayouts)
+	{
+		std::cerr << scriptPath << ": unknown submit mode or layout" << std::endl;
+		return EXIT_FAILURE;
+	}
+	submitMode = (SubmitMode)mode;
+	cubeLayout = (CubeLayout)layout;
+	herdPlace(script.herd);
+
+	headless = true;
+	if (!headlessInit(script.width, script.height))
+		return EXIT_FAILURE;
+
+	init();
+	reshape(script.width, script.height);
+	if (submitMode != (SubmitMode)mode)
+	{
+		// a fallback would measure something else than the baseline did
+		headlessShutdown();
+		return EXIT_FAILURE;
+	}
+	profilerEnabled = true;
+	profilerInit();
+
+	for (int f = 0; f < script.warmup + script.frames; f++)
+	{
+		if (f == script.warmup)
+			profilerClear();
+
+		glm::vec3 rotation;
+		float distance;
+		benchCamera(script, f, rotation, distance);
+		rotAngleWorldx = rotation.x;
+		rotAngleWorldy = rotation.y;
+		rotAngleWorldz = rotation.z;
+		viewMat = glm::lookAt(glm::vec3(0, 0, distance), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
+		animTime = benchAnimTime(script, f);
+
+		display();
+		glFinish();
+	}
+	profilerFinish();
+
+	if (submitMode != (SubmitMode)mode)
+	{
+		// fell back mid-run, see display()
+		shaderShutdown();
+		headlessShutdown();
+		return EXIT_FAILURE;
+	}
+
+	BenchResult result;
+	result.renderer = (const char *)glGetString(GL_RENDERER);
+	result.frameMs = profilerFrameMs();
+	result.cpuMs = profilerCpuMs();
+	result.gpuMs = profilerGpuMs();
+	std::vector<unsigned char> rgb;
+	headlessReadFrame(rgb);
+	result.imageHash = benchHash(rgb);
+
+	std::cout << "bench: " << script.name << ", " << script.frames << " frames at " << script.width << "x"
+			  << script.height << ", " << herdSize << " elephants, " << submitModeName(submitMode) << " submission, "
+			  << cubeLayoutName(cubeLayout) << " cubes" << std::endl;
+	profilerPrintSummary(std::cout);
+
+	bool passed = true;
+	if (jsonPath)
+		passed = benchWriteJson(jsonPath, script, result);
+	if (baselinePath)
+		passed = benchCompare(baselinePath, result, thresholdPercent, std::cout) && passed;
+
+	shaderShutdown();
+	headlessShutdown();
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+//----------------------------------------------------------------------------
+
 int main(int argc, char **argv)
 {
+	int threads = 0, benchElephants = 0, benchFrames = 100;
+	int headlessFrames = 0, meshBenchFrames = 0, submitBenchFrames = 0, width = 700, height = 700;
+	const char *dumpPattern = NULL;
+	const char *scriptPath = NULL, *jsonPath = NULL, *baselinePath = NULL;
+	double threshold = 10.0;
+	std::vector<int> sweep;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-headless") == 0)
+			headlessFrames = i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]) ? atoi(argv[++i]) : 100;
+		else if (strcmp(argv[i], "-size") == 0 && i + 1 < argc)
+			sscanf(argv[++i], "%dx%d", &width, &height);
+		else if (strcmp(argv[i], "-dump") == 0 && i + 1 < argc)
+		{
+			dumpPattern = argv[++i];
+			if (!dumpPatternValid(dumpPattern))
+			{
+				std::cerr << "-dump needs a file name with one %d for the frame number, e.g. frame%04d.ppm"
+						  << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (strcmp(argv[i], "-herd") == 0 && i + 1 < argc)
+			herdPlace(glm::max(atoi(argv[++i]), 1));
+		else if (strcmp(argv[i], "-instanced") == 0)
+			submitMode = SUBMIT_INSTANCED;
+		else if (strcmp(argv[i], "-submit") == 0 && i + 1 < argc)
+		{
+			const char *name = argv[++i];
+			for (int m = 0; m < NumSubmitModes; m++)
+				if (strcmp(name, submitModeName((SubmitMode)m)) == 0)
+					submitMode = (SubmitMode)m;
+		}
+		else if (strcmp(argv[i], "-layout") == 0 && i + 1 < argc)
+		{
+			const char *name = argv[++i];
+			for (int l = 0; l < NumCubeLayouts; l++)
+				if (strcmp(name, cubeLayoutName((CubeLayout)l)) == 0)
+					cubeLayout = (CubeLayout)l;
+		}
+		else if (strcmp(argv[i], "-meshbench") == 0)
+			meshBenchFrames = i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]) ? atoi(argv[++i]) : 50;
+		else if (strcmp(argv[i], "-submitbench") == 0)
+			submitBenchFrames = i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]) ? atoi(argv[++i]) : 50;
+		else if (strcmp(argv[i], "-sweep") == 0 && i + 1 < argc)
+		{
+			// comma-separated herd sizes
+			sweep.clear();
+			for (char *s = argv[++i], *end; *s; s = *end == ',' ? end + 1 : end)
+			{
+				int count = (int)strtol(s, &end, 10);
+				if (end == s)
+					break;
+				sweep.push_back(glm::max(count, 1));
+			}
+		}
+		else if (strcmp(argv[i], "-script") == 0 && i + 1 < argc)
+			scriptPath = argv[++i];
+		else if (strcmp(argv[i], "-json") == 0 && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (strcmp(argv[i], "-baseline") == 0 && i + 1 < argc)
+			baselinePath = argv[++i];
+		else if (strcmp(argv[i], "-threshold") == 0 && i + 1 < argc)
+			threshold = glm::max(atof(argv[++i]), 0.0);
+		else if (strcmp(argv[i], "-pace") == 0 && i + 1 < argc)
+		{
+			const char *name = argv[++i];
+			for (int m = 0; m < NumPaceModes; m++)
+				if (strcmp(name, paceModeName((PaceMode)m)) == 0)
+					paceMode = (PaceMode)m;
+			headlessPaced = true;
+		}
+		else if (strcmp(argv[i], "-hz") == 0 && i + 1 < argc)
+			paceHz = glm::max(atof(argv[++i]), 1.0);
+		else if (strcmp(argv[i], "-bake") == 0 && i + 1 < argc)
+			bakePhases = glm::max(atoi(argv[++i]), 2);
+		else if (strcmp(argv[i], "-nobufferstorage") == 0)
+			ringForceFallback = true;
+		else if (strcmp(argv[i], "-noshadercache") == 0)
+			programCacheEnabled = false;
+		else if (strcmp(argv[i], "-noparallelcompile") == 0)
+			shaderParallelCompile = false;
+		else if (strcmp(argv[i], "-nostatecache") == 0)
+			stateCacheEnabled = false;
+		else if (strcmp(argv[i], "-profile") == 0)
+		{
+			profilerEnabled = true;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				profilePath = argv[++i];
+		}
+		else if (strcmp(argv[i], "-jobbench") == 0)
+		{
+			benchElephants = i + 1 < argc ? atoi(argv[++i]) : 4096;
+			if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+				benchFrames = atoi(argv[++i]);
+		}
+	}
+
+	if (!rigValidate())
+		return EXIT_FAILURE;
+
+	// never trust a SIMD kernel that disagrees with the scalar reference
+	float kernelError = mat4SelfTest(mat4Isa);
+	if (kernelError > 1.0e-4f)
+	{
+		std::cerr << "matrix kernel " << mat4IsaName(mat4Isa) << " is off by " << kernelError
+				  << ", using scalar" << std::endl;
+		mat4Isa = MAT4_SCALAR;
+	}
+	std::cout << "matrix kernel: " << mat4IsaName(mat4Isa) << std::endl;
+
+	if (benchElephants > 0)
+		return herdBenchmark(benchElephants, benchFrames, threads);
+
+	jobsInit(threads);
+
+	if (meshBenchFrames > 0)
+		return runMeshBenchmark(meshBenchFrames, width, height);
+
+	if (submitBenchFrames > 0)
+	{
+		if (sweep.empty())
+			sweep = {1, 16, 64, 256};
+		return runSubmitBenchmark(submitBenchFrames, width, height, sweep);
+	}
+
+	if (scriptPath)
+		return runBenchScript(scriptPath, jsonPath, baselinePath, threshold);
+
+	if (headlessFrames > 0)
+		return runHeadless(headlessFrames, width, height, dumpPattern);
+
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
 	glutInitWindowSize(700, 700);
-	glutInitContextVersion(3, 2);
+	glutInitContextVersion(3, 3);
 	glutInitContextProfile(GLUT_CORE_PROFILE);
 	glutCreateWindow("Color Elephant");
 
+#ifdef __GLEW_H__
 	glewInit();
+#endif
 
 	init();
+	profilerInit();
+	schedulerInit();
 
 	glutDisplayFunc(display);
 	glutKeyboardFunc(keyboard);
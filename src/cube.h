@@ -27,7 +27,12 @@
 #ifdef __APPLE__  // include Mac OS X verions of headers
 #  include <OpenGL/OpenGL.h>
 #  include <GLUT/glut.h>
-#else // non-Mac OS X operating systems
+#elif defined(__linux__) // libOpenGL exports every core entry point, so
+                         //   the headless EGL build needs no GLEW
+#  define GL_GLEXT_PROTOTYPES
+#  include "GL/freeglut.h"
+#  include "GL/freeglut_ext.h"
+#else // other operating systems
 #  include "GL/glew.h"
 #  include "GL/freeglut.h"
 #  include "GL/freeglut_ext.h"
@@ -41,8 +46,15 @@
 //  --- Include our class libraries and constants ---
 //
 
-//  Helper function to load vertex and fragment shader files
-GLuint InitShader(const char* vertexShaderFile, const char* fragmentShaderFile);
+//  Helper function to load vertex and fragment shader files, optionally
+//    with defines ("NAME NAME=VALUE ...") injected after #version
+GLuint InitShader(const char* vertexShaderFile, const char* fragmentShaderFile,
+                  const char* defines = NULL);
+
+//  Helpers to query the current context: version as major * 10 + minor,
+//    and whether an extension is advertised
+int GLVersion();
+bool HasGLExtension(const char* name);
 
 //  Defined constant for when numbers are too small to be used in the
 //    denominator of a division operation.  This is only used if the
@@ -0,0 +1,327 @@
+//
+// The cube primitive in flat, indexed, packed and bufferless layouts
+//
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "cubemesh.h"
+#include "glstate.h"
+#include "reflect.h"
+#include "glm/glm.hpp"
+#include "glm/packing.hpp"
+#include "glm/gtc/packing.hpp"
+
+CubeLayout cubeLayout = CUBE_FLAT;
+
+typedef glm::vec4 color4;
+typedef glm::vec4 point4;
+
+const int NumVertices = 36; //(6 faces)(2 triangles/face)(3 vertices/triangle)
+
+point4 points[NumVertices];
+color4 colors[NumVertices];
+GLushort indices[NumVertices]; // corners of the same triangles
+
+// Vertices of a unit cube centered at origin, sides aligned with axes
+point4 vertices[8] = {
+	point4(-0.5, -0.5, 0.5, 1.0),
+	point4(-0.5, 0.5, 0.5, 1.0),
+	point4(0.5, 0.5, 0.5, 1.0),
+	point4(0.5, -0.5, 0.5, 1.0),
+	point4(-0.5, -0.5, -0.5, 1.0),
+	point4(-0.5, 0.5, -0.5, 1.0),
+	point4(0.5, 0.5, -0.5, 1.0),
+	point4(0.5, -0.5, -0.5, 1.0)};
+
+// RGBA colors
+color4 vertex_colors[8] = {
+	color4(0.0, 0.0, 0.0, 1.0), // black
+	color4(0.0, 1.0, 1.0, 1.0), // cyan
+	color4(1.0, 0.0, 1.0, 1.0), // magenta
+	color4(1.0, 1.0, 0.0, 1.0), // yellow
+	color4(1.0, 0.0, 0.0, 1.0), // red
+	color4(0.0, 1.0, 0.0, 1.0), // green
+	color4(0.0, 0.0, 1.0, 1.0), // blue
+	color4(1.0, 1.0, 1.0, 1.0)	// white
+};
+
+//----------------------------------------------------------------------------
+
+// quad generates two triangles for each face and assigns colors
+//    to the vertices, recording which corner each one came from
+int Index = 0;
+void quad(int a, int b, int c, int d)
+{
+	colors[Index] = vertex_colors[a];
+	points[Index] = vertices[a];
+	indices[Index] = a;
+	Index++;
+	colors[Index] = vertex_colors[b];
+	points[Index] = vertices[b];
+	indices[Index] = b;
+	Index++;
+	colors[Index] = vertex_colors[c];
+	points[Index] = vertices[c];
+	indices[Index] = c;
+	Index++;
+	colors[Index] = vertex_colors[a];
+	points[Index] = vertices[a];
+	indices[Index] = a;
+	Index++;
+	colors[Index] = vertex_colors[c];
+	points[Index] = vertices[c];
+	indices[Index] = c;
+	Index++;
+	colors[Index] = vertex_colors[d];
+	points[Index] = vertices[d];
+	indices[Index] = d;
+	Index++;
+}
+
+//----------------------------------------------------------------------------
+
+// generate 12 triangles: 36 vertices and 36 colors
+void colorcube()
+{
+	quad(1, 0, 3, 2);
+	quad(2, 3, 7, 6);
+	quad(3, 0, 4, 7);
+	quad(6, 5, 1, 2);
+	quad(4, 5, 6, 7);
+	quad(5, 4, 0, 1);
+}
+
+//----------------------------------------------------------------------------
+
+// packed layout: two 32-bit words per corner
+struct PackedVertex
+{
+	GLuint position; // snorm 10:10:10:2, corner * 2
+	GLuint color;	 // unorm 8:8:8:8
+};
+
+static GLuint meshBuffers[NumCubeLayouts];
+static GLuint indexBuffer;
+static std::vector<GLuint *> layoutPrograms; // followed through reloads
+
+// per-draw arguments of cubeMeshMultiDraw, all alike
+static std::vector<GLint> multiFirsts;
+static std::vector<GLsizei> multiCounts;
+static std::vector<const GLvoid *> multiOffsets;
+
+// what glMultiDraw*Indirect reads for each draw
+struct ArraysCommand
+{
+	GLuint count, instanceCount, first, baseInstance;
+};
+
+struct ElementsCommand
+{
+	GLuint count, instanceCount, firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+//----------------------------------------------------------------------------
+
+const char *cubeLayoutName(CubeLayout layout)
+{
+	static const char *names[NumCubeLayouts] = {"flat", "indexed", "packed", "vertexid"};
+	return layout >= 0 && layout < NumCubeLayouts ? names[layout] : "unknown";
+}
+
+int cubeMeshVertexSize(CubeLayout layout)
+{
+	if (layout == CUBE_VERTEXID)
+		return 0;
+	return layout == CUBE_PACKED ? (int)sizeof(PackedVertex) : (int)(sizeof(point4) + sizeof(color4));
+}
+
+GLsizeiptr cubeMeshBytes(CubeLayout layout)
+{
+	if (layout == CUBE_VERTEXID)
+		return 0;
+	if (layout == CUBE_FLAT)
+		return NumVertices * cubeMeshVertexSize(layout);
+	return 8 * cubeMeshVertexSize(layout) + sizeof(indices);
+}
+
+//----------------------------------------------------------------------------
+
+void cubeMeshInit()
+{
+	colorcube();
+
+	PackedVertex packed[8];
+	for (int i = 0; i < 8; i++)
+	{
+		packed[i].position = glm::packSnorm3x10_1x2(glm::vec4(glm::vec3(vertices[i]) * 2.0f, 1.0f));
+		packed[i].color = glm::packUnorm4x8(vertex_colors[i]);
+	}
+
+	glGenBuffers(NumCubeLayouts, meshBuffers);
+
+	// positions first, then colors, in each float layout
+	stateBindBuffer(GL_ARRAY_BUFFER, meshBuffers[CUBE_FLAT]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(points) + sizeof(colors),
+				 NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(points), points);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(points), sizeof(colors), colors);
+
+	stateBindBuffer(GL_ARRAY_BUFFER, meshBuffers[CUBE_INDEXED]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices) + sizeof(vertex_colors),
+				 NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(vertices), sizeof(vertex_colors), vertex_colors);
+
+	stateBindBuffer(GL_ARRAY_BUFFER, meshBuffers[CUBE_PACKED]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(packed), packed, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &indexBuffer);
+	stateBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+}
+
+void cubeMeshCorners(glm::vec4 positions[8], glm::vec4 cornerColors[8], GLushort triangles[36])
+{
+	for (int i = 0; i < 8; i++)
+	{
+		positions[i] = vertices[i];
+		cornerColors[i] = vertex_colors[i];
+	}
+	for (int i = 0; i < NumVertices; i++)
+		triangles[i] = indices[i];
+}
+
+void cubeMeshAttribs(CubeLayout layout, GLuint program)
+{
+	// the shader ignores its vertex attributes
+	if (layout == CUBE_VERTEXID)
+		return;
+
+	GLint vPosition = reflectAttrib(program, "vPosition", GL_FLOAT_VEC4);
+	GLint vColor = reflectAttrib(program, "vColor", GL_FLOAT_VEC4);
+	if (vPosition < 0 || vColor < 0)
+		return;
+	glEnableVertexAttribArray(vPosition);
+	glEnableVertexAttribArray(vColor);
+
+	stateBindBuffer(GL_ARRAY_BUFFER, meshBuffers[layout]);
+	if (layout == CUBE_PACKED)
+	{
+		glVertexAttribPointer(vPosition, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex),
+							  BUFFER_OFFSET(offsetof(PackedVertex, position)));
+		glVertexAttribPointer(vColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex),
+							  BUFFER_OFFSET(offsetof(PackedVertex, color)));
+	}
+	else
+	{
+		GLsizei count = layout == CUBE_FLAT ? NumVertices : 8;
+		glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, 0,
+							  BUFFER_OFFSET(0));
+		glVertexAttribPointer(vColor, 4, GL_FLOAT, GL_FALSE, 0,
+							  BUFFER_OFFSET(count * sizeof(point4)));
+	}
+
+	// the element buffer binding is part of the VAO
+	if (layout != CUBE_FLAT)
+		stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+}
+
+//----------------------------------------------------------------------------
+
+static void setLayoutUniforms(GLuint program)
+{
+	stateUseProgram(program);
+	reflectSet(program, "positionScale", cubeLayout == CUBE_PACKED ? 0.5f : 1.0f);
+	reflectSet(program, "cubeFromVertexID", (int)(cubeLayout == CUBE_VERTEXID));
+}
+
+void cubeMeshBindProgram(GLuint &program)
+{
+	if (std::find(layoutPrograms.begin(), layoutPrograms.end(), &program) == layoutPrograms.end())
+		layoutPrograms.push_back(&program);
+	setLayoutUniforms(program);
+}
+
+void cubeMeshSelect(CubeLayout layout)
+{
+	cubeLayout = layout;
+	for (size_t i = 0; i < layoutPrograms.size(); i++)
+		setLayoutUniforms(*layoutPrograms[i]);
+}
+
+static bool drawsArrays()
+{
+	return cubeLayout == CUBE_FLAT || cubeLayout == CUBE_VERTEXID;
+}
+
+void cubeMeshDraw(GLsizei instances)
+{
+	if (drawsArrays())
+	{
+		if (instances == 1)
+			glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+		else
+			glDrawArraysInstanced(GL_TRIANGLES, 0, NumVertices, instances);
+	}
+	else
+	{
+		if (instances == 1)
+			glDrawElements(GL_TRIANGLES, NumVertices, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0));
+		else
+			glDrawElementsInstanced(GL_TRIANGLES, NumVertices, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0), instances);
+	}
+}
+
+void cubeMeshMultiDraw(GLsizei draws)
+{
+	if ((GLsizei)multiCounts.size() < draws)
+	{
+		multiFirsts.resize(draws, 0);
+		multiCounts.resize(draws, NumVertices);
+		multiOffsets.resize(draws, BUFFER_OFFSET(0));
+	}
+
+	if (drawsArrays())
+		glMultiDrawArrays(GL_TRIANGLES, &multiFirsts[0], &multiCounts[0], draws);
+	else
+		glMultiDrawElements(GL_TRIANGLES, &multiCounts[0], GL_UNSIGNED_SHORT, &multiOffsets[0], draws);
+}
+
+GLsizeiptr cubeMeshIndirectStride()
+{
+	return drawsArrays() ? sizeof(ArraysCommand) : sizeof(ElementsCommand);
+}
+
+void cubeMeshIndirectCommands(void *dst, GLsizei draws)
+{
+	if (drawsArrays())
+	{
+		ArraysCommand *commands = (ArraysCommand *)dst;
+		for (GLsizei i = 0; i < draws; i++)
+		{
+			ArraysCommand command = {NumVertices, 1, 0, (GLuint)i};
+			commands[i] = command;
+		}
+	}
+	else
+	{
+		ElementsCommand *commands = (ElementsCommand *)dst;
+		for (GLsizei i = 0; i < draws; i++)
+		{
+			ElementsCommand command = {NumVertices, 1, 0, 0, (GLuint)i};
+			commands[i] = command;
+		}
+	}
+}
+
+void cubeMeshDrawIndirect(GLintptr offset, GLsizei draws)
+{
+	if (drawsArrays())
+		glMultiDrawArraysIndirect(GL_TRIANGLES, BUFFER_OFFSET(offset), draws, 0);
+	else
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, BUFFER_OFFSET(offset), draws, 0);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _CUBEMESH_H_
+#define _CUBEMESH_H_
+
+#include "cube.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Cube mesh vertex layouts ---
+//
+//   Every part is the same colored unit cube, stored four ways:
+//
+//     flat     36 vertices of vec4 position + vec4 color, 32 bytes each,
+//                drawn with glDrawArrays (the original layout)
+//     indexed  the 8 corners in the same format plus 36 GLushort indices
+//     packed   the 8 corners in 8 bytes each, position as
+//                GL_INT_2_10_10_10_REV snorm and color as 4 unorm bytes,
+//                plus the same indices
+//     vertexid no buffers at all: the vertex shader looks corner, position
+//                and color up in bit masks by gl_VertexID, trading vertex
+//                fetch for a little ALU work
+//
+//   Each corner has a single color, so 8 vertices reproduce the cube
+//     exactly.  Snorm cannot hold +-0.5, so packed corners are stored at
+//     +-1 and shaders multiply by the positionScale uniform.  Programs drawing
+//     the cube include cubeVertex() from cubevertex.glsl, steered by the
+//     positionScale and cubeFromVertexID uniforms.
+//
+
+enum CubeLayout
+{
+	CUBE_FLAT,
+	CUBE_INDEXED,
+	CUBE_PACKED,
+	CUBE_VERTEXID,
+	NumCubeLayouts
+};
+
+extern CubeLayout cubeLayout;
+
+const char *cubeLayoutName(CubeLayout layout);
+
+// Bytes of vertex and index data one cube of the layout occupies
+GLsizeiptr cubeMeshBytes(CubeLayout layout);
+int cubeMeshVertexSize(CubeLayout layout);
+
+// Build the buffers of every layout
+void cubeMeshInit();
+
+// The 8 corners, their colors and the corner of each triangle vertex, for
+//   building other meshes out of the cube; valid after cubeMeshInit()
+void cubeMeshCorners(glm::vec4 positions[8], glm::vec4 cornerColors[8], GLushort triangles[36]);
+
+// Point a program's vPosition and vColor at the layout in the bound VAO and
+//   attach its index buffer
+void cubeMeshAttribs(CubeLayout layout, GLuint program);
+
+// Remember a program whose positionScale follows the layout; the variable
+//   is kept, so a program that replaces it follows as well
+void cubeMeshBindProgram(GLuint &program);
+
+// Switch every bound program to layout
+void cubeMeshSelect(CubeLayout layout);
+
+// Draw instances cubes of the current layout from the bound VAO
+void cubeMeshDraw(GLsizei instances);
+
+// Draw the cube draws times in one glMultiDrawArrays / glMultiDrawElements,
+//   for shaders that tell the draws apart by gl_DrawIDARB
+void cubeMeshMultiDraw(GLsizei draws);
+
+// Bytes per indirect command of the current layout
+GLsizeiptr cubeMeshIndirectStride();
+
+// Write draws indirect commands of one cube each, draw i with base instance
+//   i, so instanced attributes step once per draw
+void cubeMeshIndirectCommands(void *dst, GLsizei draws);
+
+// Issue draws commands at offset in the bound GL_DRAW_INDIRECT_BUFFER
+void cubeMeshDrawIndirect(GLintptr offset, GLsizei draws);
+
+#endif // _CUBEMESH_H_
@@ -0,0 +1,35 @@
+// The colored unit cube of every layout, see cubemesh.h; the including
+//   shader declares vPosition and vColor first
+
+uniform float positionScale; // 0.5 for the packed cube layout
+uniform bool  cubeFromVertexID; // no vertex arrays: build the cube from gl_VertexID
+
+// Corners a, b, c, d of each face, 3 bits each, drawn as triangles abc acd
+//   in the order of colorcube()
+const uint cubeFaces[6] = uint[6](0x4C1u, 0xDDAu, 0xF03u, 0x46Eu, 0xFACu, 0x225u);
+
+// Bit n of each mask is the x, y, z sign and r, g, b of corner n
+const uint cubeX = 0xCCu, cubeY = 0x66u, cubeZ = 0x0Fu;
+const uint cubeR = 0x9Cu, cubeG = 0xAAu, cubeB = 0xC6u;
+
+float cubeBit(uint mask, uint corner)
+{
+  return float((mask >> corner) & 1u);
+}
+
+void cubeVertex(out vec4 position, out vec4 vertexColor)
+{
+  if (!cubeFromVertexID)
+  {
+    position = vec4(vPosition.xyz * positionScale, vPosition.w);
+    vertexColor = vColor;
+    return;
+  }
+
+  int k = gl_VertexID % 6;
+  int slot = k < 3 ? k : k - 2 - int(k == 3);
+  uint corner = (cubeFaces[gl_VertexID / 6] >> uint(3 * slot)) & 7u;
+
+  position = vec4(cubeBit(cubeX, corner) - 0.5, cubeBit(cubeY, corner) - 0.5, cubeBit(cubeZ, corner) - 0.5, 1.0);
+  vertexColor = vec4(cubeBit(cubeR, corner), cubeBit(cubeG, corner), cubeBit(cubeB, corner), 1.0);
+}
@@ -0,0 +1,116 @@
+//
+// Radix-sorted draw command list
+//
+
+#include <algorithm>
+#include <iostream>
+
+#include "drawlist.h"
+
+void drawListSort(DrawList &list)
+{
+	size_t count = list.commands.size();
+	list.passes = 0;
+	if (count < 2)
+		return;
+
+	// all eight histograms in one read of the keys
+	size_t histograms[8][256] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = list.commands[i].key;
+		for (int b = 0; b < 8; b++)
+			histograms[b][(key >> (8 * b)) & 0xFF]++;
+	}
+
+	list.scratch.resize(count);
+	DrawCommand *from = &list.commands[0];
+	DrawCommand *to = &list.scratch[0];
+
+	for (int b = 0; b < 8; b++)
+	{
+		size_t *histogram = histograms[b];
+
+		// a byte every key has in common does not reorder anything
+		if (histogram[(from[0].key >> (8 * b)) & 0xFF] == count)
+			continue;
+
+		size_t offset = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			size_t n = histogram[d];
+			histogram[d] = offset;
+			offset += n;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			to[histogram[(from[i].key >> (8 * b)) & 0xFF]++] = from[i];
+
+		DrawCommand *swap = from;
+		from = to;
+		to = swap;
+		list.passes++;
+	}
+
+	// an odd number of passes left the result in the scratch half
+	if (from != &list.commands[0])
+		list.commands.swap(list.scratch);
+}
+
+size_t drawListRunEnd(const DrawList &list, size_t begin)
+{
+	uint32_t state = drawKeyState(list.commands[begin].key);
+	size_t end = begin + 1;
+	while (end < list.commands.size() && drawKeyState(list.commands[end].key) == state)
+		end++;
+	return end;
+}
+
+//----------------------------------------------------------------------------
+
+bool drawListMerge(DrawList &list, const std::vector<DrawRecorder> &recorders)
+{
+	// a payload has no room for the tag of any further recorder
+	if (recorders.size() > (size_t)MaxDrawRecorders)
+	{
+		std::cerr << "drawlist: " << recorders.size() << " recorders, at most " << MaxDrawRecorders << " fit a payload"
+				  << std::endl;
+		list.commands.clear();
+		return false;
+	}
+
+	struct TaggedSpan
+	{
+		DrawSpan span;
+		uint32_t recorder;
+	};
+
+	std::vector<TaggedSpan> spans;
+	size_t count = 0;
+	for (size_t r = 0; r < recorders.size(); r++)
+	{
+		for (size_t s = 0; s < recorders[r].spans.size(); s++)
+		{
+			TaggedSpan tagged = {recorders[r].spans[s], (uint32_t)r};
+			spans.push_back(tagged);
+			count += tagged.span.end - tagged.span.begin;
+		}
+	}
+	std::sort(spans.begin(), spans.end(),
+			  [](const TaggedSpan &a, const TaggedSpan &b) { return a.span.order < b.span.order; });
+
+	list.commands.resize(count);
+	DrawCommand *dst = count ? &list.commands[0] : NULL;
+	for (size_t s = 0; s < spans.size(); s++)
+	{
+		const std::vector<DrawCommand> &commands = recorders[spans[s].recorder].commands;
+		uint32_t tag = spans[s].recorder << DrawPayloadIndexBits;
+		for (size_t i = spans[s].span.begin; i < spans[s].span.end; i++)
+		{
+			dst->key = commands[i].key;
+			dst->payload = tag | commands[i].payload;
+			dst++;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _DRAWLIST_H_
+#define _DRAWLIST_H_
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "mat4batch.h"
+
+//----------------------------------------------------------------------------
+//
+//  --- Sortable draw command list ---
+//
+//   Draws are recorded instead of issued: each command is a 64-bit sort key
+//     and a payload the submitting code interprets, e.g. the index of the
+//     part's matrix.  Once the frame is recorded the list is radix sorted on
+//     the key and handed back as runs of commands that share all state, so
+//     each run can go out as one instanced draw.
+//
+//   Key, most significant first:
+//
+//     63..54  program    slot numbers assigned by the caller, ordered
+//     53..44  vertex array   from the most to the least costly change
+//     43..32  material
+//     31..0   depth      view distance as float bits; non-negative floats
+//                          order like their bits, so this is front to back
+//
+//   The sort is stable, so commands with equal keys keep their recording
+//     order.  Byte positions in which every key agrees are not sorted on;
+//     with one program and vertex array that leaves the depth bytes only.
+//
+//   Recording can be spread over the job system: each thread appends to its
+//     own DrawRecorder, commands plus the matrices they draw, and the render
+//     thread merges the recorders into one list before sorting.  Commands
+//     are recorded in spans tagged with an order, e.g. the first item of the
+//     job, and merged by it, so the list does not depend on which thread
+//     happened to run which job.  A merged payload is the recorder index in
+//     the top DrawPayloadRecorderBits bits and its own payload below.
+//
+
+struct DrawCommand
+{
+	uint64_t key;
+	uint32_t payload;
+};
+
+struct DrawList
+{
+	std::vector<DrawCommand> commands;
+	std::vector<DrawCommand> scratch; // the other half of each radix pass
+	int passes;						  // byte passes the last sort needed
+};
+
+const int DrawKeyProgramBits = 10;
+const int DrawKeyVertexArrayBits = 10;
+const int DrawKeyMaterialBits = 12;
+
+// Everything above the depth: commands that agree on it can be merged
+inline uint32_t drawKeyState(uint64_t key)
+{
+	return (uint32_t)(key >> 32);
+}
+
+// Replace the depth of key
+inline uint64_t drawKeyDepth(uint64_t key, float depth)
+{
+	// behind the eye sorts first; -0 and NaN as 0
+	uint32_t depthBits = 0;
+	if (depth > 0.0f)
+		memcpy(&depthBits, &depth, sizeof(depthBits));
+	return (key & ~(uint64_t)0xFFFFFFFF) | depthBits;
+}
+
+inline uint64_t drawKey(unsigned program, unsigned vertexArray, unsigned material, float depth)
+{
+	uint32_t state = (program & ((1u << DrawKeyProgramBits) - 1)) << (DrawKeyVertexArrayBits + DrawKeyMaterialBits) |
+					 (vertexArray & ((1u << DrawKeyVertexArrayBits) - 1)) << DrawKeyMaterialBits |
+					 (material & ((1u << DrawKeyMaterialBits) - 1));
+	return drawKeyDepth((uint64_t)state << 32, depth);
+}
+
+inline void drawListClear(DrawList &list)
+{
+	list.commands.clear();
+}
+
+inline void drawListAdd(DrawList &list, uint64_t key, uint32_t payload)
+{
+	DrawCommand command = {key, payload};
+	list.commands.push_back(command);
+}
+
+// Stable LSD radix sort of the commands by key
+void drawListSort(DrawList &list);
+
+// End of the run of commands from begin on that share the state of begin
+size_t drawListRunEnd(const DrawList &list, size_t begin);
+
+//----------------------------------------------------------------------------
+
+const int DrawPayloadRecorderBits = 8;
+const int DrawPayloadIndexBits = 32 - DrawPayloadRecorderBits;
+const int MaxDrawRecorders = 1 << DrawPayloadRecorderBits;
+
+// Commands in [begin, end) of a recorder, merged by order
+struct DrawSpan
+{
+	int order;
+	size_t begin, end;
+};
+
+struct DrawRecorder
+{
+	std::vector<DrawCommand> commands;
+	std::vector<DrawSpan> spans;
+	Mat4Array matrices; // arena the payloads index; keeps its capacity
+};
+
+inline void drawRecorderClear(DrawRecorder &recorder)
+{
+	recorder.commands.clear();
+	recorder.spans.clear();
+	recorder.matrices.clear();
+}
+
+// Start the span later commands go to
+inline void drawRecorderSpan(DrawRecorder &recorder, int order)
+{
+	DrawSpan span = {order, recorder.commands.size(), recorder.commands.size()};
+	recorder.spans.push_back(span);
+}
+
+// Append count matrices to the arena and return the first, for the caller to
+//   fill; its index is the return value minus &matrices[0]
+inline glm::mat4 *drawRecorderMatrices(DrawRecorder &recorder, size_t count)
+{
+	size_t base = recorder.matrices.size();
+	recorder.matrices.resize(base + count);
+	return &recorder.matrices[base];
+}
+
+inline void drawRecorderAdd(DrawRecorder &recorder, uint64_t key, uint32_t payload)
+{
+	DrawCommand command = {key, payload};
+	recorder.commands.push_back(command);
+	recorder.spans.back().end = recorder.commands.size();
+}
+
+// Replace the list with the spans of every recorder in order, payloads
+//   tagged with their recorder; false, leaving the list empty, if there
+//   are more than MaxDrawRecorders recorders
+bool drawListMerge(DrawList &list, const std::vector<DrawRecorder> &recorders);
+
+// Matrix of a merged payload that indexes its recorder's arena
+inline const glm::mat4 &drawRecordedMatrix(const std::vector<DrawRecorder> &recorders, uint32_t payload)
+{
+	return recorders[payload >> DrawPayloadIndexBits].matrices[payload & ((1u << DrawPayloadIndexBits) - 1)];
+}
+
+#endif // _DRAWLIST_H_
@@ -0,0 +1,205 @@
+//
+// Redundant bind and upload filter with per-frame counters
+//
+
+#include "glstate.h"
+
+bool stateCacheEnabled = true;
+StateCounts stateFrameCounts;
+
+static StateCounts totalCounts;
+static long long countedFrames = 0;
+
+// nothing a GL name can be, so the first bind always goes through
+static const GLuint Unknown = ~0u;
+
+enum BufferSlot
+{
+	SLOT_ARRAY,
+	SLOT_ELEMENT_ARRAY,
+	SLOT_UNIFORM,
+	SLOT_TEXTURE,
+	SLOT_COPY_WRITE,
+	SLOT_DRAW_INDIRECT,
+	NumBufferSlots
+};
+
+static const int MaxUniformBindings = 16;
+static const int MaxTextureUnits = 8;
+
+struct BufferRange
+{
+	GLuint buffer;
+	GLintptr offset;
+	GLsizeiptr size; // -1 for the whole buffer
+};
+
+static GLuint currentProgram;
+static GLuint currentVertexArray;
+static GLuint currentBuffers[NumBufferSlots];
+static BufferRange currentRanges[MaxUniformBindings];
+static GLuint activeUnit;
+static GLuint currentTextures[MaxTextureUnits]; // of the one target used per unit
+static GLenum currentTargets[MaxTextureUnits];
+
+static const char *callNames[NumStateCalls] = {"program", "vertex array", "buffer", "buffer range",
+											   "texture", "uniform", "block data"};
+
+//----------------------------------------------------------------------------
+
+static int bufferSlot(GLenum target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER:
+		return SLOT_ARRAY;
+	case GL_ELEMENT_ARRAY_BUFFER:
+		return SLOT_ELEMENT_ARRAY;
+	case GL_UNIFORM_BUFFER:
+		return SLOT_UNIFORM;
+	case GL_TEXTURE_BUFFER:
+		return SLOT_TEXTURE;
+	case GL_COPY_WRITE_BUFFER:
+		return SLOT_COPY_WRITE;
+	case GL_DRAW_INDIRECT_BUFFER:
+		return SLOT_DRAW_INDIRECT;
+	default:
+		return -1;
+	}
+}
+
+void stateUseProgram(GLuint program)
+{
+	if (stateCount(STATE_PROGRAM, program == currentProgram))
+	{
+		glUseProgram(program);
+		currentProgram = program;
+	}
+}
+
+void stateBindVertexArray(GLuint vao)
+{
+	if (stateCount(STATE_VERTEX_ARRAY, vao == currentVertexArray))
+	{
+		glBindVertexArray(vao);
+		currentVertexArray = vao;
+		currentBuffers[SLOT_ELEMENT_ARRAY] = Unknown;
+	}
+}
+
+void stateBindBuffer(GLenum target, GLuint buffer)
+{
+	int slot = bufferSlot(target);
+	if (stateCount(STATE_BUFFER, slot >= 0 && buffer == currentBuffers[slot]))
+	{
+		glBindBuffer(target, buffer);
+		if (slot >= 0)
+			currentBuffers[slot] = buffer;
+	}
+}
+
+// Indexed binds also bind the generic target
+static void bindIndexed(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	bool cached = target == GL_UNIFORM_BUFFER && index < (GLuint)MaxUniformBindings;
+	BufferRange *range = cached ? &currentRanges[index] : NULL;
+
+	bool redundant = cached && range->buffer == buffer && range->offset == offset && range->size == size;
+	if (!stateCount(STATE_BUFFER_RANGE, redundant))
+		return;
+
+	if (size < 0)
+		glBindBufferBase(target, index, buffer);
+	else
+		glBindBufferRange(target, index, buffer, offset, size);
+
+	if (range)
+	{
+		range->buffer = buffer;
+		range->offset = offset;
+		range->size = size;
+	}
+	int slot = bufferSlot(target);
+	if (slot >= 0)
+		currentBuffers[slot] = buffer;
+}
+
+void stateBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	bindIndexed(target, index, buffer, 0, -1);
+}
+
+void stateBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	bindIndexed(target, index, buffer, offset, size);
+}
+
+void stateBindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	bool cached = unit < (GLuint)MaxTextureUnits;
+	bool redundant = cached && currentTargets[unit] == target && currentTextures[unit] == texture;
+	if (!stateCount(STATE_TEXTURE, redundant))
+		return;
+
+	if (activeUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		activeUnit = unit;
+	}
+	glBindTexture(target, texture);
+	if (cached)
+	{
+		currentTargets[unit] = target;
+		currentTextures[unit] = texture;
+	}
+}
+
+void stateReset()
+{
+	currentProgram = Unknown;
+	currentVertexArray = Unknown;
+	for (int i = 0; i < NumBufferSlots; i++)
+		currentBuffers[i] = Unknown;
+	for (int i = 0; i < MaxUniformBindings; i++)
+		currentRanges[i].buffer = Unknown;
+	activeUnit = Unknown;
+	for (int i = 0; i < MaxTextureUnits; i++)
+		currentTextures[i] = Unknown;
+}
+
+//----------------------------------------------------------------------------
+
+void stateEndFrame()
+{
+	for (int i = 0; i < NumStateCalls; i++)
+	{
+		totalCounts.issued[i] += stateFrameCounts.issued[i];
+		totalCounts.skipped[i] += stateFrameCounts.skipped[i];
+		stateFrameCounts.issued[i] = 0;
+		stateFrameCounts.skipped[i] = 0;
+	}
+	countedFrames++;
+}
+
+void stateReport(std::ostream &os)
+{
+	if (countedFrames == 0)
+		return;
+
+	long long issued = 0, skipped = 0;
+	for (int i = 0; i < NumStateCalls; i++)
+	{
+		issued += totalCounts.issued[i];
+		skipped += totalCounts.skipped[i];
+	}
+
+	os << "state: " << (stateCacheEnabled ? "cached" : "uncached") << ", per frame " << (double)issued / countedFrames
+	   << " calls issued, " << (double)skipped / countedFrames << " skipped" << std::endl;
+	for (int i = 0; i < NumStateCalls; i++)
+	{
+		if (totalCounts.issued[i] + totalCounts.skipped[i] == 0)
+			continue;
+		os << "  " << callNames[i] << ": " << (double)totalCounts.issued[i] / countedFrames << " issued, "
+		   << (double)totalCounts.skipped[i] / countedFrames << " skipped" << std::endl;
+	}
+}
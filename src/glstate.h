@@ -0,0 +1,81 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _GLSTATE_H_
+#define _GLSTATE_H_
+
+#include <iostream>
+
+#include "cube.h"
+
+//----------------------------------------------------------------------------
+//
+//  --- GL state cache ---
+//
+//   The render thread binds programs, vertex arrays, buffers and textures
+//     through the state* calls below, which remember what is bound and drop
+//     a call that would bind it again.  Uniform values are filtered the same
+//     way by uniformSet() in reflect.h, against the value each program last
+//     received, and the camera block by cameraUpdate().
+//
+//   Every call is counted as issued or skipped, per frame, so the savings
+//     can be measured; -nostatecache issues them all, for comparison.
+//
+//   The cache only knows what went through it.  The element array binding
+//     belongs to the vertex array and is forgotten when that changes; after
+//     deleting objects or binding around the cache, call stateReset().
+//
+
+enum StateCall
+{
+	STATE_PROGRAM,	   // glUseProgram
+	STATE_VERTEX_ARRAY, // glBindVertexArray
+	STATE_BUFFER,	   // glBindBuffer
+	STATE_BUFFER_RANGE, // glBindBufferRange / glBindBufferBase
+	STATE_TEXTURE,	   // glActiveTexture + glBindTexture
+	STATE_UNIFORM,	   // glUniform*
+	STATE_BLOCK_DATA,   // glBufferSubData of a uniform block
+	NumStateCalls
+};
+
+struct StateCounts
+{
+	long long issued[NumStateCalls];
+	long long skipped[NumStateCalls];
+};
+
+extern bool stateCacheEnabled;
+
+// Counts of the frame in progress
+extern StateCounts stateFrameCounts;
+
+// Count one call; returns whether it must be issued
+inline bool stateCount(StateCall call, bool redundant)
+{
+	if (redundant && stateCacheEnabled)
+	{
+		stateFrameCounts.skipped[call]++;
+		return false;
+	}
+	stateFrameCounts.issued[call]++;
+	return true;
+}
+
+void stateUseProgram(GLuint program);
+void stateBindVertexArray(GLuint vao);
+void stateBindBuffer(GLenum target, GLuint buffer);
+void stateBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void stateBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+void stateBindTexture(GLuint unit, GLenum target, GLuint texture);
+
+// Forget everything bound, so the next call of each kind is issued
+void stateReset();
+
+// Add the frame's counts to the totals and start the next frame
+void stateEndFrame();
+
+// Calls issued and skipped per frame, by kind, so far
+void stateReport(std::ostream &os);
+
+#endif // _GLSTATE_H_
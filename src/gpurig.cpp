@@ -0,0 +1,89 @@
+//
+// Elephant rig evaluated in the vertex shader
+//
+
+#include <cmath>
+
+#include "camera.h"
+#include "cubemesh.h"
+#include "glstate.h"
+#include "gpurig.h"
+#include "herd.h"
+#include "profiler.h"
+#include "reflect.h"
+#include "shaders.h"
+
+static GLuint rigProgram;
+static GLuint rigVaos[NumCubeLayouts];
+static GLuint rigBuffer;
+
+static UniformHandle<glm::mat4> worldMatrix;
+static UniformHandle<float> cycleTime;
+
+//----------------------------------------------------------------------------
+
+// Uniforms and bindings of rigProgram, again after every reload
+static void setupRigProgram()
+{
+	glUniformBlockBinding(rigProgram, reflectBlock(rigProgram, "Rig", sizeof(RigBlock)), RigBinding);
+	stateUseProgram(rigProgram);
+	reflectSet(rigProgram, "partCount", (int)NumRigModels);
+	reflectSet(rigProgram, "cyclePeriod", RigWalkPeriod);
+	worldMatrix = reflectUniform<glm::mat4>(rigProgram, "mWorld");
+	cycleTime = reflectUniform<float>(rigProgram, "cycleTime");
+
+	cubeMeshBindProgram(rigProgram);
+	cameraBindProgram(rigProgram);
+}
+
+void gpuRigInit()
+{
+	RigBlock block;
+	int slot = 0;
+
+	for (int i = 0; i < NumRigParts; i++)
+	{
+		const RigPart &part = rigParts[i];
+		block.offset[i] = glm::vec4(part.offset, (float)part.parent);
+		block.rest[i] = glm::vec4(part.restAxis, part.restAngle);
+		block.pivot[i] = glm::vec4(part.pivot, 0.0f);
+		block.anim[i] = glm::vec4(part.animAxis, part.animGain);
+		block.scale[i] = glm::vec4(part.scale, 0.0f);
+
+		if (part.scale != glm::vec3(0.0f))
+			block.drawn[slot++] = glm::ivec4(i, 0, 0, 0);
+	}
+
+	glGenBuffers(1, &rigBuffer);
+	stateBindBuffer(GL_UNIFORM_BUFFER, rigBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STATIC_DRAW);
+	stateBindBufferBase(GL_UNIFORM_BUFFER, RigBinding, rigBuffer);
+
+	rigProgram = InitShader("src/vshader_rig.glsl", "src/fshader.glsl");
+
+	glGenVertexArrays(NumCubeLayouts, rigVaos);
+	for (int l = 0; l < NumCubeLayouts; l++)
+	{
+		stateBindVertexArray(rigVaos[l]);
+		cubeMeshAttribs((CubeLayout)l, rigProgram);
+		herdInstanceAttribs(rigProgram, NumRigModels);
+	}
+	stateBindVertexArray(0);
+
+	setupRigProgram();
+	shaderWatch(rigProgram, setupRigProgram);
+}
+
+void gpuRigDraw(const glm::mat4 &worldMat, float timeMs)
+{
+	herdUpdateInstances();
+
+	ProfileScope scope(PROFILE_SUBMIT);
+
+	stateUseProgram(rigProgram);
+	uniformSet(worldMatrix, worldMat);
+	uniformSet(cycleTime, fmodf(timeMs, RigWalkPeriod));
+
+	stateBindVertexArray(rigVaos[cubeLayout]);
+	cubeMeshDraw(herdSize * NumRigModels);
+}
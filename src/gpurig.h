@@ -0,0 +1,56 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _GPURIG_H_
+#define _GPURIG_H_
+
+#include "cube.h"
+#include "rig.h"
+#include "std140.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Rig evaluated on the GPU ---
+//
+//   The rig table is uploaded once as a uniform block and vshader_rig.glsl
+//     evaluates the walk cycle and the joint chain of every part vertex by
+//     vertex: leg swing, head and nose included.  The part comes from
+//     gl_InstanceID, and time and phase from the herd instance data, so
+//     the CPU only ever uploads elephant placements, and only when the herd
+//     changes.  The cost of posing no longer grows with the part count on
+//     the CPU side.
+//
+
+// layout(std140) uniform Rig in vshader_rig.glsl
+struct RigBlock
+{
+	glm::vec4 offset[NumRigParts]; // w parent index
+	glm::vec4 rest[NumRigParts];   // w angle
+	glm::vec4 pivot[NumRigParts];
+	glm::vec4 anim[NumRigParts];   // w gain
+	glm::vec4 scale[NumRigParts];
+	glm::ivec4 drawn[NumRigModels]; // x part index
+};
+
+typedef Std140Layout<glm::vec4[NumRigParts], glm::vec4[NumRigParts], glm::vec4[NumRigParts],
+					 glm::vec4[NumRigParts], glm::vec4[NumRigParts], glm::ivec4[NumRigModels]>
+	RigLayout;
+STD140_MEMBER(RigBlock, RigLayout, 0, offset);
+STD140_MEMBER(RigBlock, RigLayout, 1, rest);
+STD140_MEMBER(RigBlock, RigLayout, 2, pivot);
+STD140_MEMBER(RigBlock, RigLayout, 3, anim);
+STD140_MEMBER(RigBlock, RigLayout, 4, scale);
+STD140_MEMBER(RigBlock, RigLayout, 5, drawn);
+STD140_SIZE(RigBlock, RigLayout);
+
+const GLuint RigBinding = 2;
+
+// Upload the rig table and build the program
+void gpuRigInit();
+
+// Draw the whole herd posed on the GPU at animation time timeMs
+void gpuRigDraw(const glm::mat4 &worldMat, float timeMs);
+
+#endif // _GPURIG_H_
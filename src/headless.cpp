@@ -0,0 +1,191 @@
+//
+// Windowless EGL context and offscreen framebuffer
+//
+
+#include <cstdio>
+#include <cstring>
+
+#include "cube.h"
+#include "headless.h"
+
+#ifdef __linux__
+#  include <EGL/egl.h>
+#  include <EGL/eglext.h>
+
+static EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+static EGLContext eglContext = EGL_NO_CONTEXT;
+static EGLConfig eglConfig = (EGLConfig)0;
+#endif
+
+static GLuint framebuffer;
+static GLuint renderbuffers[2];
+static int frameWidth, frameHeight;
+
+//----------------------------------------------------------------------------
+
+#ifdef __linux__
+
+static bool createContext()
+{
+	// prefer a display that needs no X server or GPU at all
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (eglDisplay == EGL_NO_DISPLAY)
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+	{
+		std::cerr << "headless: no EGL display (error 0x" << std::hex << eglGetError() << std::dec << ")"
+				  << std::endl;
+		return false;
+	}
+
+	// rendering goes to our own framebuffer object, so any config will do
+	//   and none at all is fine where EGL_KHR_no_config_context exists
+	const EGLint configAttribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE};
+	EGLConfig config = (EGLConfig)0;
+	EGLint configCount = 0;
+	eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configCount);
+
+	eglBindAPI(EGL_OPENGL_API);
+
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE};
+	eglConfig = configCount > 0 ? config : (EGLConfig)0;
+	eglContext = eglCreateContext(eglDisplay, eglConfig, EGL_NO_CONTEXT, contextAttribs);
+
+	if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		std::cerr << "headless: cannot create a surfaceless 3.3 core context (error 0x" << std::hex
+				  << eglGetError() << std::dec << ")" << std::endl;
+		return false;
+	}
+
+	std::cout << "headless: EGL " << major << "." << minor << ", " << glGetString(GL_RENDERER) << ", "
+			  << glGetString(GL_VERSION) << std::endl;
+	return true;
+}
+
+static bool makeWorkerCurrent(void *context)
+{
+	EGLContext c = context ? (EGLContext)context : EGL_NO_CONTEXT;
+	return eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, c) == EGL_TRUE;
+}
+
+#endif // __linux__
+
+//----------------------------------------------------------------------------
+
+bool headlessInit(int width, int height)
+{
+#ifdef __linux__
+	if (!createContext())
+		return false;
+
+	frameWidth = width;
+	frameHeight = height;
+
+	// color and depth storage standing in for the window's back buffer
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "headless: framebuffer is incomplete" << std::endl;
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+	return true;
+#else
+	(void)width;
+	(void)height;
+	std::cerr << "headless: rendering without a window needs EGL and is only built on Linux" << std::endl;
+	return false;
+#endif
+}
+
+void headlessShutdown()
+{
+#ifdef __linux__
+	if (eglContext == EGL_NO_CONTEXT)
+		return;
+
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(2, renderbuffers);
+
+	eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(eglDisplay, eglContext);
+	eglTerminate(eglDisplay);
+	eglContext = EGL_NO_CONTEXT;
+	eglDisplay = EGL_NO_DISPLAY;
+#endif
+}
+
+bool headlessWorkerContext(ShaderWorkerContext &worker)
+{
+#ifdef __linux__
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE};
+	EGLContext context = eglCreateContext(eglDisplay, eglConfig, eglContext, contextAttribs);
+	if (context == EGL_NO_CONTEXT)
+		return false;
+
+	worker.context = context;
+	worker.makeCurrent = makeWorkerCurrent;
+	return true;
+#else
+	(void)worker;
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+void headlessReadFrame(std::vector<unsigned char> &rgb)
+{
+	size_t stride = (size_t)frameWidth * 3;
+	std::vector<unsigned char> rows(stride * frameHeight);
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, frameWidth, frameHeight, GL_RGB, GL_UNSIGNED_BYTE, &rows[0]);
+
+	// GL returns the bottom row first
+	rgb.resize(rows.size());
+	for (int y = 0; y < frameHeight; y++)
+		memcpy(&rgb[y * stride], &rows[(frameHeight - 1 - y) * stride], stride);
+}
+
+bool headlessWritePPM(const char *path, const std::vector<unsigned char> &rgb)
+{
+	FILE *fp = fopen(path, "wb");
+	if (fp == NULL)
+	{
+		std::cerr << "headless: cannot write " << path << std::endl;
+		return false;
+	}
+
+	fprintf(fp, "P6\n%d %d\n255\n", frameWidth, frameHeight);
+	bool ok = fwrite(&rgb[0], 1, rgb.size(), fp) == rgb.size();
+	fclose(fp);
+	return ok;
+}
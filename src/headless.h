@@ -0,0 +1,34 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _HEADLESS_H_
+#define _HEADLESS_H_
+
+#include <vector>
+
+#include "shaders.h"
+
+//----------------------------------------------------------------------------
+//
+//  --- Headless rendering ---
+//
+//   Creates an OpenGL 3.3 core context without any window, through EGL on
+//     Mesa's surfaceless platform (llvmpipe is fine), and binds a framebuffer
+//     object of the requested size in place of the window's back buffer.
+//     init() and display() then run unchanged.  Only available on Linux.
+//
+
+bool headlessInit(int width, int height);
+void headlessShutdown();
+
+// A context sharing objects with the headless one, for the shader worker
+bool headlessWorkerContext(ShaderWorkerContext &worker);
+
+// Read the current frame back as tightly packed RGB rows, top row first
+void headlessReadFrame(std::vector<unsigned char> &rgb);
+
+// Write an RGB frame as a binary PPM
+bool headlessWritePPM(const char *path, const std::vector<unsigned char> &rgb);
+
+#endif // _HEADLESS_H_
@@ -0,0 +1,367 @@
+//
+// Herd placement and instanced rendering of the elephant parts
+//
+
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+#include "camera.h"
+#include "cubemesh.h"
+#include "glstate.h"
+#include "herd.h"
+#include "jobs.h"
+#include "profiler.h"
+#include "reflect.h"
+#include "rig.h"
+#include "shaders.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+int herdSize = 1;
+SubmitMode submitMode = SUBMIT_UNIFORM;
+
+std::vector<glm::mat4> herdMats(1, glm::mat4(1.0f));
+std::vector<float> herdPhases(1, 0.0f);
+
+Mat4Array herdPartMats;
+
+static const float herdSpacing = 2.5f;
+
+// elephants posed per job; one pose is roughly 60 matrix products
+static const int herdGrain = 64;
+
+static GLuint herdProgram;
+static GLuint herdVaos[NumCubeLayouts];
+static GLint modelAttrib;
+
+// the herd program fetching matrices by draw ID, where the context can
+static bool drawIdSupported, indirectSupported;
+static GLuint drawIdProgram;
+static GLuint drawIdVaos[NumCubeLayouts];
+static RingTexture drawIdTexture;
+static UniformHandle<int> modelBase;
+
+static GLuint instanceBuffer;
+static int instanceCount = -1; // elephants in instanceBuffer
+
+//----------------------------------------------------------------------------
+
+const char *submitModeName(SubmitMode mode)
+{
+	static const char *names[NumSubmitModes] = {"uniform", "ubo", "instanced", "baked", "gpurig", "merged", "skinned", "sorted", "multidraw", "indirect"};
+	return mode >= 0 && mode < NumSubmitModes ? names[mode] : "unknown";
+}
+
+bool submitModeSupported(SubmitMode mode)
+{
+	if (mode == SUBMIT_MULTIDRAW)
+		return drawIdSupported;
+	if (mode == SUBMIT_INDIRECT)
+		return indirectSupported;
+	return mode >= 0 && mode < NumSubmitModes;
+}
+
+//----------------------------------------------------------------------------
+
+// Uniforms and bindings of herdProgram, again after every reload
+static void setupHerdProgram()
+{
+	cubeMeshBindProgram(herdProgram);
+	cameraBindProgram(herdProgram);
+}
+
+// Uniforms and bindings of drawIdProgram, again after every reload
+static void setupDrawIdProgram()
+{
+	stateUseProgram(drawIdProgram);
+	reflectSet(drawIdProgram, "models", 0);
+	modelBase = reflectUniform<int>(drawIdProgram, "modelBase");
+	cubeMeshBindProgram(drawIdProgram);
+	cameraBindProgram(drawIdProgram);
+}
+
+void herdInit()
+{
+	herdProgram = InitShader("src/vshader_herd.glsl", "src/fshader.glsl");
+	modelAttrib = reflectAttrib(herdProgram, "mModel", GL_FLOAT_MAT4);
+
+	glGenVertexArrays(NumCubeLayouts, herdVaos);
+	for (int l = 0; l < NumCubeLayouts; l++)
+	{
+		// per-vertex attributes come from the shared cube mesh
+		stateBindVertexArray(herdVaos[l]);
+		cubeMeshAttribs((CubeLayout)l, herdProgram);
+
+		// per-instance model matrix, one column per attribute slot; the
+		//   buffer and offset are set by every herdDraw
+		for (int col = 0; col < 4; col++)
+		{
+			glEnableVertexAttribArray(modelAttrib + col);
+			glVertexAttribDivisor(modelAttrib + col, 1);
+		}
+	}
+
+	setupHerdProgram();
+	shaderWatch(herdProgram, setupHerdProgram);
+
+	// base instances make the instanced attributes step per indirect draw
+	indirectSupported = GLVersion() >= 43 ||
+						(HasGLExtension("GL_ARB_multi_draw_indirect") && HasGLExtension("GL_ARB_base_instance"));
+
+	drawIdSupported = HasGLExtension("GL_ARB_shader_draw_parameters");
+	if (drawIdSupported)
+	{
+		drawIdProgram = InitShader("src/vshader_herd.glsl", "src/fshader.glsl", "MODEL_FROM_DRAW_ID");
+
+		glGenVertexArrays(NumCubeLayouts, drawIdVaos);
+		for (int l = 0; l < NumCubeLayouts; l++)
+		{
+			stateBindVertexArray(drawIdVaos[l]);
+			cubeMeshAttribs((CubeLayout)l, drawIdProgram);
+		}
+		ringTextureInit(drawIdTexture);
+
+		setupDrawIdProgram();
+		shaderWatch(drawIdProgram, setupDrawIdProgram);
+	}
+
+	glGenBuffers(1, &instanceBuffer);
+
+	stateBindVertexArray(0);
+}
+
+//----------------------------------------------------------------------------
+
+void herdPlace(int count)
+{
+	int side = (int)ceil(sqrt((double)count));
+	float center = (side - 1) * 0.5f;
+
+	herdSize = count;
+	herdMats.resize(count);
+	herdPhases.resize(count);
+
+	// shrink the grid so the whole herd stays inside the default view
+	glm::mat4 fitMat = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f / side));
+
+	for (int i = 0; i < count; i++)
+	{
+		int row = i / side, col = i % side;
+		glm::vec3 pos((col - center) * herdSpacing, (row - center) * herdSpacing, 0.0f);
+		herdMats[i] = glm::translate(fitMat, pos);
+
+		// spread the elephants over the 200*pi ms walk cycle so they do not
+		//   march in lockstep; the first one keeps the original timing
+		herdPhases[i] = fmod(i * 0.618034f, 1.0f) * RigWalkPeriod;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void herdCompose(const glm::mat4 &prefixMat, float timeMs, glm::mat4 *out)
+{
+	jobsParallelFor(herdSize, herdGrain, [&](int begin, int end) {
+		// each thread keeps its own pose cache, so static parts are only
+		//   ever computed once per thread
+		static thread_local RigPose pose;
+
+		for (int i = begin; i < end; i++)
+		{
+			rigEvaluate(pose, rigWalkCycle(timeMs + herdPhases[i]));
+
+			glm::mat4 rootMat = prefixMat * herdMats[i];
+			Mat4Batch parts = {NumRigModels, NULL, pose.model, false,
+							   1, &rootMat, out + (size_t)i * NumRigModels, NULL, NULL};
+			mat4Compose(parts);
+		}
+	});
+}
+
+static_assert(MaxJobThreads <= MaxDrawRecorders, "every job thread needs a recorder a payload can tag");
+
+void herdRecord(const glm::mat4 &prefixMat, float timeMs, const glm::mat4 &view, uint64_t stateKey,
+				std::vector<DrawRecorder> &recorders)
+{
+	recorders.resize(jobsThreadCount());
+	for (size_t r = 0; r < recorders.size(); r++)
+		drawRecorderClear(recorders[r]);
+
+	jobsParallelFor(herdSize, herdGrain, [&](int begin, int end) {
+		static thread_local RigPose pose;
+
+		// merged by the first elephant, whichever thread runs the job
+		DrawRecorder &recorder = recorders[jobsThreadIndex()];
+		drawRecorderSpan(recorder, begin);
+
+		for (int i = begin; i < end; i++)
+		{
+			rigEvaluate(pose, rigWalkCycle(timeMs + herdPhases[i]));
+
+			glm::mat4 *out = drawRecorderMatrices(recorder, NumRigModels);
+			uint32_t first = (uint32_t)(out - &recorder.matrices[0]);
+
+			glm::mat4 rootMat = prefixMat * herdMats[i];
+			Mat4Batch parts = {NumRigModels, NULL, pose.model, false, 1, &rootMat, out, NULL, NULL};
+			mat4Compose(parts);
+
+			for (int p = 0; p < NumRigModels; p++)
+			{
+				// distance along the view direction of the part's center
+				const glm::vec4 &center = out[p][3];
+				float depth = -(view[0][2] * center.x + view[1][2] * center.y + view[2][2] * center.z + view[3][2]);
+				drawRecorderAdd(recorder, drawKeyDepth(stateKey, depth), first + p);
+			}
+		}
+	});
+}
+
+int herdBenchmark(int count, int frames, int maxThreads)
+{
+	if (maxThreads <= 0)
+		maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads <= 0)
+		maxThreads = 1;
+
+	herdPlace(count);
+	herdPartMats.resize((size_t)count * NumRigModels);
+	glm::mat4 prefixMat(1.0f);
+	std::vector<DrawRecorder> recorders;
+
+	std::cout << "herd pose benchmark: " << count << " elephants, " << frames << " frames, "
+			  << mat4IsaName(mat4Isa) << " kernel" << std::endl;
+	std::cout << "threads\tms/frame\tspeedup\trecord ms\tspeedup" << std::endl;
+
+	double baseMs = 0.0, baseRecordMs = 0.0;
+	for (int threads = 1;; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads)
+	{
+		jobsInit(threads);
+		herdCompose(prefixMat, 0.0f, &herdPartMats[0]); // warm up the pools and caches
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++)
+			herdCompose(prefixMat, f * 20.0f, &herdPartMats[0]);
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		double ms = elapsed.count() / frames;
+
+		// the same poses recorded as draw commands into per-thread buffers
+		herdRecord(prefixMat, 0.0f, prefixMat, 0, recorders);
+		start = std::chrono::steady_clock::now();
+		for (int f = 0; f < frames; f++)
+			herdRecord(prefixMat, f * 20.0f, prefixMat, 0, recorders);
+		elapsed = std::chrono::steady_clock::now() - start;
+		double recordMs = elapsed.count() / frames;
+
+		if (threads == 1)
+		{
+			baseMs = ms;
+			baseRecordMs = recordMs;
+		}
+		std::cout << threads << "\t" << ms << "\t" << baseMs / ms << "\t" << recordMs << "\t"
+				  << baseRecordMs / recordMs << std::endl;
+
+		if (threads == maxThreads)
+			break;
+	}
+
+	jobsShutdown();
+	return EXIT_SUCCESS;
+}
+
+//----------------------------------------------------------------------------
+
+// Use herdProgram with its instance attributes on this frame's slice of
+//   the buffer
+static void bindHerdModels(GLuint buffer, GLintptr offset)
+{
+	stateUseProgram(herdProgram);
+	stateBindVertexArray(herdVaos[cubeLayout]);
+	stateBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (int col = 0; col < 4; col++)
+		glVertexAttribPointer(modelAttrib + col, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+							  BUFFER_OFFSET(offset + sizeof(glm::vec4) * col));
+}
+
+void herdDraw(GLuint buffer, GLintptr offset, int count)
+{
+	if (count == 0)
+		return;
+
+	ProfileScope scope(PROFILE_SUBMIT);
+	bindHerdModels(buffer, offset);
+	cubeMeshDraw(count);
+}
+
+bool herdMultiDraw(const RingBuffer &ring, GLintptr offset, int count)
+{
+	if (count == 0 || !drawIdSupported)
+		return true;
+
+	ProfileScope scope(PROFILE_SUBMIT);
+
+	int base = ringTextureBind(drawIdTexture, 0, ring, offset, count * sizeof(glm::mat4));
+	if (base < 0)
+		return false;
+
+	stateUseProgram(drawIdProgram);
+	uniformSet(modelBase, base);
+	stateBindVertexArray(drawIdVaos[cubeLayout]);
+	cubeMeshMultiDraw(count);
+	return true;
+}
+
+void herdDrawIndirect(GLuint buffer, GLintptr offset, GLintptr commandOffset, int count)
+{
+	if (count == 0 || !indirectSupported)
+		return;
+
+	ProfileScope scope(PROFILE_SUBMIT);
+	bindHerdModels(buffer, offset);
+	stateBindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer);
+	cubeMeshDrawIndirect(commandOffset, count);
+}
+
+//----------------------------------------------------------------------------
+
+void herdInstanceAttribs(GLuint program, GLuint divisor)
+{
+	GLint rootAttrib = reflectAttrib(program, "mRoot", GL_FLOAT_MAT4);
+	GLint phaseAttrib = reflectAttrib(program, "phaseOffset", GL_FLOAT);
+
+	stateBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (int col = 0; col < 4 && rootAttrib >= 0; col++)
+	{
+		glEnableVertexAttribArray(rootAttrib + col);
+		glVertexAttribPointer(rootAttrib + col, 4, GL_FLOAT, GL_FALSE, sizeof(HerdInstance),
+							  BUFFER_OFFSET(offsetof(HerdInstance, root) + sizeof(glm::vec4) * col));
+		glVertexAttribDivisor(rootAttrib + col, divisor);
+	}
+
+	// shaders that do not pose, like the skinned one, have no phase
+	if (phaseAttrib >= 0)
+	{
+		glEnableVertexAttribArray(phaseAttrib);
+		glVertexAttribPointer(phaseAttrib, 1, GL_FLOAT, GL_FALSE, sizeof(HerdInstance),
+							  BUFFER_OFFSET(offsetof(HerdInstance, phaseOffset)));
+		glVertexAttribDivisor(phaseAttrib, divisor);
+	}
+}
+
+void herdUpdateInstances()
+{
+	if (instanceCount == herdSize)
+		return;
+
+	ProfileScope scope(PROFILE_UPLOAD);
+
+	std::vector<HerdInstance> instances(herdSize);
+	for (int i = 0; i < herdSize; i++)
+	{
+		instances[i].root = herdMats[i];
+		instances[i].phaseOffset = herdPhases[i];
+	}
+
+	stateBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(HerdInstance), &instances[0], GL_STATIC_DRAW);
+	instanceCount = herdSize;
+}
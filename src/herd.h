@@ -0,0 +1,108 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _HERD_H_
+#define _HERD_H_
+
+#include <vector>
+
+#include "cube.h"
+#include "drawlist.h"
+#include "mat4batch.h"
+#include "ringbuffer.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Herd of elephants ---
+//
+//   The herd places herdSize elephants on a square grid.  Every body part of
+//     every elephant is the same cube, so instead of one glDrawArrays per part
+//     the instanced path uploads all part model matrices as a per-instance
+//     buffer and draws the whole herd with a single glDrawArraysInstanced.
+//
+
+// How the part matrices reach the vertex shader
+enum SubmitMode
+{
+	SUBMIT_UNIFORM,	  // glUniformMatrix4fv + glDrawArrays per part
+	SUBMIT_UBO,		  // per-part glBindBufferRange into the frame ring + glDrawArrays
+	SUBMIT_INSTANCED, // one glDrawArraysInstanced reading matrices from the frame ring
+	SUBMIT_BAKED,	  // one instanced draw blending poses baked into a texture buffer
+	SUBMIT_GPURIG,	  // one instanced draw posing every part in the vertex shader
+	SUBMIT_MERGED,	  // one instanced draw of a merged mesh per elephant, bone palettes in the frame ring
+	SUBMIT_SKINNED,	  // as merged, but a smooth mesh blended by dual-quaternion bones
+	SUBMIT_SORTED,	  // per-part draw commands radix sorted front to back, merged into instanced runs
+	SUBMIT_MULTIDRAW, // one glMultiDraw* of every part, matrices fetched by gl_DrawIDARB from the frame ring
+	SUBMIT_INDIRECT,  // one glMultiDraw*Indirect, per-part commands and matrices in the frame ring
+	NumSubmitModes
+};
+
+extern int herdSize;
+extern SubmitMode submitMode;
+
+const char *submitModeName(SubmitMode mode);
+
+// Whether the context can run mode; valid after herdInit()
+bool submitModeSupported(SubmitMode mode);
+
+// Placement matrix and walk cycle offset in ms of each elephant in the herd
+extern std::vector<glm::mat4> herdMats;
+extern std::vector<float> herdPhases;
+
+// CPU copy of every drawn part of every elephant, NumRigModels per elephant,
+//   for the paths that cannot compose straight into GL memory
+extern Mat4Array herdPartMats;
+
+// Create the instanced program and a VAO per cube mesh layout
+void herdInit();
+
+// Lay out count elephants on a grid scaled to fit the default view
+void herdPlace(int count);
+
+// Pose every elephant at animation time timeMs and write prefixMat *
+//   placement * part model to out (herdSize * NumRigModels matrices), spread
+//   over the job system
+void herdCompose(const glm::mat4 &prefixMat, float timeMs, glm::mat4 *out);
+
+// Pose the herd as herdCompose does, but have each job thread record the
+//   part matrices into its own recorder, one per jobsThreadCount(), with a
+//   draw command each: stateKey at the part's distance along view
+void herdRecord(const glm::mat4 &prefixMat, float timeMs, const glm::mat4 &view, uint64_t stateKey,
+				std::vector<DrawRecorder> &recorders);
+
+// Time herdCompose and herdRecord with 1, 2, 4, ... up to maxThreads workers
+//   (0 for one per hardware thread)
+int herdBenchmark(int count, int frames, int maxThreads);
+
+// Draw count part model matrices, already in buffer at offset, in one
+//   instanced call; the camera comes from the Camera block
+void herdDraw(GLuint buffer, GLintptr offset, int count);
+
+// The same as one draw per part: a multi-draw whose draws read their matrix
+//   from the ring by gl_DrawIDARB, or count indirect commands at
+//   commandOffset in buffer whose base instances step through the matrices.
+//   The multi-draw returns false, drawing nothing, if the matrices are too
+//   big for a texture buffer.
+bool herdMultiDraw(const RingBuffer &ring, GLintptr offset, int count);
+void herdDrawIndirect(GLuint buffer, GLintptr offset, GLintptr commandOffset, int count);
+
+// What the paths that pose on the GPU read for each elephant
+struct HerdInstance
+{
+	glm::mat4 root; // placement in the herd
+	float phaseOffset;
+};
+
+// Feed a program's mRoot and phaseOffset, where it has them, from the herd
+//   instance buffer in the bound VAO, stepping to the next elephant every
+//   divisor instances: NumRigModels when each part is an instance, 1 when
+//   each elephant is
+void herdInstanceAttribs(GLuint program, GLuint divisor);
+
+// Re-upload the instance buffer if the herd has changed size; placement
+//   only depends on the size
+void herdUpdateInstances();
+
+#endif // _HERD_H_
@@ -0,0 +1,202 @@
+//
+// Work-stealing thread pool
+//
+
+#include <atomic>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "jobs.h"
+
+struct Job
+{
+	int begin, end;
+	const std::function<void(int, int)> *body;
+	std::atomic<int> *pending;
+};
+
+struct JobQueue
+{
+	std::mutex lock;
+	std::deque<Job> jobs;
+};
+
+// one per worker; worker i (thread index i + 1) owns queue i
+static std::vector<JobQueue *> queues;
+static std::vector<std::thread> workers;
+
+static std::mutex sleepLock;
+static std::condition_variable wakeUp;
+static std::atomic<int> queuedJobs(0);
+static bool quitting = false;
+
+// the last job of a jobsParallelFor wakes its caller
+static std::mutex doneLock;
+static std::condition_variable allDone;
+
+static thread_local int threadIndex = 0;
+
+//----------------------------------------------------------------------------
+
+static bool takeJob(int self, Job &job)
+{
+	int count = (int)queues.size();
+
+	// own queue first, newest job first
+	{
+		JobQueue &q = *queues[self];
+		std::lock_guard<std::mutex> guard(q.lock);
+		if (!q.jobs.empty())
+		{
+			job = q.jobs.back();
+			q.jobs.pop_back();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	// then steal the oldest job of the next busy queue
+	for (int i = 1; i < count; i++)
+	{
+		JobQueue &q = *queues[(self + i) % count];
+		std::lock_guard<std::mutex> guard(q.lock);
+		if (!q.jobs.empty())
+		{
+			job = q.jobs.front();
+			q.jobs.pop_front();
+			queuedJobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void runJob(const Job &job)
+{
+	(*job.body)(job.begin, job.end);
+
+	// under the lock, so the caller cannot miss the wake-up between testing
+	//   pending and going to sleep
+	std::lock_guard<std::mutex> guard(doneLock);
+	if (job.pending->fetch_sub(1, std::memory_order_acq_rel) == 1)
+		allDone.notify_all();
+}
+
+static void workerLoop(int self)
+{
+	threadIndex = self + 1;
+	for (;;)
+	{
+		Job job;
+		if (takeJob(self, job))
+		{
+			runJob(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wakeUp.wait(guard, [] { return quitting || queuedJobs > 0; });
+		if (quitting)
+			return;
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void jobsInit(int threadCount)
+{
+	jobsShutdown();
+
+	if (threadCount <= 0)
+		threadCount = (int)std::thread::hardware_concurrency();
+	if (threadCount <= 0)
+		threadCount = 1;
+	if (threadCount > MaxJobThreads - 1)
+	{
+		std::cerr << "jobs: " << threadCount << " threads requested, using " << MaxJobThreads - 1 << std::endl;
+		threadCount = MaxJobThreads - 1;
+	}
+
+	// workers must be joined before their std::thread objects are destroyed,
+	//   also when the program leaves through exit()
+	static bool registered = false;
+	if (!registered)
+	{
+		atexit(jobsShutdown);
+		registered = true;
+	}
+
+	quitting = false;
+	for (int i = 0; i < threadCount; i++)
+		queues.push_back(new JobQueue);
+	for (int i = 0; i < threadCount; i++)
+		workers.push_back(std::thread(workerLoop, i));
+}
+
+void jobsShutdown()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		quitting = true;
+	}
+	wakeUp.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	for (size_t i = 0; i < queues.size(); i++)
+		delete queues[i];
+	queues.clear();
+}
+
+int jobsThreadCount()
+{
+	return (int)queues.size() + 1;
+}
+
+int jobsThreadIndex()
+{
+	return threadIndex;
+}
+
+void jobsParallelFor(int count, int grain, const std::function<void(int begin, int end)> &body)
+{
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	// no pool yet
+	if (queues.empty())
+	{
+		body(0, count);
+		return;
+	}
+
+	int chunks = (count + grain - 1) / grain;
+	std::atomic<int> pending(chunks);
+
+	// deal the chunks out round-robin so every worker starts with local work
+	for (int c = 0; c < chunks; c++)
+	{
+		Job job = {c * grain, c * grain + grain < count ? c * grain + grain : count, &body, &pending};
+		JobQueue &q = *queues[c % queues.size()];
+		std::lock_guard<std::mutex> guard(q.lock);
+		q.jobs.push_back(job);
+	}
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		queuedJobs += chunks;
+	}
+	wakeUp.notify_all();
+
+	std::unique_lock<std::mutex> guard(doneLock);
+	allDone.wait(guard, [&pending] { return pending.load(std::memory_order_acquire) == 0; });
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _JOBS_H_
+#define _JOBS_H_
+
+#include <functional>
+
+//----------------------------------------------------------------------------
+//
+//  --- Work-stealing job system ---
+//
+//   A fixed pool of worker threads, each with its own queue of jobs.  A
+//     worker takes jobs from the back of its own queue and, when that runs
+//     dry, steals from the front of the others.  The thread that calls
+//     jobsParallelFor runs none of the jobs: it sleeps until the workers
+//     are done, so the render thread is left to submit.  Before jobsInit
+//     there are no workers and everything runs inline.
+//
+//   jobsParallelFor may only be called from the thread that called jobsInit,
+//     and not from inside a job.
+//
+
+// Threads of the pool, the caller included; per-thread state may be tagged
+//   with jobsThreadIndex() in 8 bits, as the draw recorders are
+const int MaxJobThreads = 256;
+
+// Start threadCount workers, at most MaxJobThreads - 1; 0 picks one per
+//   hardware thread
+void jobsInit(int threadCount);
+void jobsShutdown();
+
+// Workers plus the thread that called jobsInit
+int jobsThreadCount();
+
+// Index in [0, jobsThreadCount()) of the calling thread, 0 for the thread
+//   that called jobsInit and workers from 1; lets jobs keep per-thread state
+int jobsThreadIndex();
+
+// Run body over [0, count) in chunks of at most grain items and wait for all
+//   of them to finish
+void jobsParallelFor(int count, int grain, const std::function<void(int begin, int end)> &body);
+
+#endif // _JOBS_H_
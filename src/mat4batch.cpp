@@ -0,0 +1,322 @@
+//
+// Batched matrix composition with scalar, SSE2, AVX and FMA kernels
+//
+// All kernels work on glm's column-major layout directly, so results can be
+//   uploaded to GL without any shuffling.  Outputs must not alias inputs.
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "mat4batch.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define MAT4_X86 1
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
+
+// GCC and Clang only emit AVX/FMA instructions inside functions that ask for
+//   them; MSVC accepts the intrinsics anywhere.
+#if defined(__GNUC__)
+#  define MAT4_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define MAT4_TARGET(isa)
+#endif
+
+Mat4Isa mat4Isa = mat4BestIsa();
+
+//----------------------------------------------------------------------------
+
+bool mat4IsaSupported(Mat4Isa isa)
+{
+	if (isa == MAT4_SCALAR)
+		return true;
+
+#if defined(MAT4_X86) && defined(__GNUC__)
+	// may run from a static initializer, before the runtime has probed the CPU
+	__builtin_cpu_init();
+
+	switch (isa)
+	{
+	case MAT4_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case MAT4_AVX:
+		return __builtin_cpu_supports("avx");
+	case MAT4_FMA:
+		return __builtin_cpu_supports("avx") && __builtin_cpu_supports("fma");
+	default:
+		return false;
+	}
+#elif defined(MAT4_X86) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool fma = (info[2] & (1 << 12)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+
+	// the OS must also save the upper halves of the ymm registers
+	if (avx && osxsave)
+		avx = (_xgetbv(0) & 6) == 6;
+	else
+		avx = false;
+
+	switch (isa)
+	{
+	case MAT4_SSE2:
+		return sse2;
+	case MAT4_AVX:
+		return avx;
+	case MAT4_FMA:
+		return avx && fma;
+	default:
+		return false;
+	}
+#else
+	return false;
+#endif
+}
+
+Mat4Isa mat4BestIsa()
+{
+	for (int isa = NumMat4Isas - 1; isa > MAT4_SCALAR; isa--)
+		if (mat4IsaSupported((Mat4Isa)isa))
+			return (Mat4Isa)isa;
+	return MAT4_SCALAR;
+}
+
+const char *mat4IsaName(Mat4Isa isa)
+{
+	static const char *names[NumMat4Isas] = {"scalar", "sse2", "avx", "fma"};
+	return isa >= 0 && isa < NumMat4Isas ? names[isa] : "unknown";
+}
+
+//----------------------------------------------------------------------------
+//
+//   out = a * b, column-major.  Each output column j is the sum of the
+//     columns of a weighted by the entries of column j of b.
+//
+
+static inline void mulScalar(const float *a, const float *b, float *out)
+{
+	for (int j = 0; j < 4; j++)
+	{
+		const float *bj = b + 4 * j;
+		for (int i = 0; i < 4; i++)
+			out[4 * j + i] = a[i] * bj[0] + a[4 + i] * bj[1] + a[8 + i] * bj[2] + a[12 + i] * bj[3];
+	}
+}
+
+#ifdef MAT4_X86
+
+MAT4_TARGET("sse2") static inline void mulSSE2(const float *a, const float *b, float *out)
+{
+	__m128 a0 = _mm_loadu_ps(a);
+	__m128 a1 = _mm_loadu_ps(a + 4);
+	__m128 a2 = _mm_loadu_ps(a + 8);
+	__m128 a3 = _mm_loadu_ps(a + 12);
+
+	for (int j = 0; j < 4; j++)
+	{
+		__m128 bj = _mm_loadu_ps(b + 4 * j);
+		__m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bj, bj, 0x00));
+		r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bj, bj, 0x55)));
+		r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bj, bj, 0xaa)));
+		r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bj, bj, 0xff)));
+		_mm_storeu_ps(out + 4 * j, r);
+	}
+}
+
+// Two output columns per 256-bit register: both lanes hold the same column
+//   of a, and each lane broadcasts its own column of b.
+MAT4_TARGET("avx") static inline void mulAVX(const float *a, const float *b, float *out)
+{
+	__m256 a0 = _mm256_broadcast_ps((const __m128 *)a);
+	__m256 a1 = _mm256_broadcast_ps((const __m128 *)(a + 4));
+	__m256 a2 = _mm256_broadcast_ps((const __m128 *)(a + 8));
+	__m256 a3 = _mm256_broadcast_ps((const __m128 *)(a + 12));
+
+	for (int j = 0; j < 4; j += 2)
+	{
+		__m256 bj = _mm256_loadu_ps(b + 4 * j);
+		__m256 r = _mm256_mul_ps(a0, _mm256_permute_ps(bj, 0x00));
+		r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_permute_ps(bj, 0x55)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_permute_ps(bj, 0xaa)));
+		r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_permute_ps(bj, 0xff)));
+		_mm256_storeu_ps(out + 4 * j, r);
+	}
+}
+
+MAT4_TARGET("avx,fma") static inline void mulFMA(const float *a, const float *b, float *out)
+{
+	__m256 a0 = _mm256_broadcast_ps((const __m128 *)a);
+	__m256 a1 = _mm256_broadcast_ps((const __m128 *)(a + 4));
+	__m256 a2 = _mm256_broadcast_ps((const __m128 *)(a + 8));
+	__m256 a3 = _mm256_broadcast_ps((const __m128 *)(a + 12));
+
+	for (int j = 0; j < 4; j += 2)
+	{
+		__m256 bj = _mm256_loadu_ps(b + 4 * j);
+		__m256 r = _mm256_mul_ps(a0, _mm256_permute_ps(bj, 0x00));
+		r = _mm256_fmadd_ps(a1, _mm256_permute_ps(bj, 0x55), r);
+		r = _mm256_fmadd_ps(a2, _mm256_permute_ps(bj, 0xaa), r);
+		r = _mm256_fmadd_ps(a3, _mm256_permute_ps(bj, 0xff), r);
+		_mm256_storeu_ps(out + 4 * j, r);
+	}
+}
+
+#endif // MAT4_X86
+
+//----------------------------------------------------------------------------
+//
+//   The batch loop is expanded once per kernel so that the multiply inlines
+//     into a function compiled for the matching instruction set.
+//
+
+#define MAT4_COMPOSE_LOOP(MUL) \
+	const float *viewProj = b.viewProj ? &(*b.viewProj)[0][0] : NULL; \
+	for (int e = 0; e < b.rootCount; e++) \
+	{ \
+		size_t first = (size_t)e * b.partCount; \
+		const glm::mat4 *locals = b.localsPerRoot ? b.locals + first : b.locals; \
+		glm::mat4 *world = b.world + first; \
+		for (int p = 0; p < b.partCount; p++) \
+		{ \
+			int parent = b.parents ? b.parents[p] : -1; \
+			const glm::mat4 &base = parent < 0 ? b.roots[e] : world[parent]; \
+			MUL(&base[0][0], &locals[p][0][0], &world[p][0][0]); \
+			if (viewProj) \
+				MUL(viewProj, &world[p][0][0], &b.pvm[first + p][0][0]); \
+		} \
+	}
+
+static void composeScalar(const Mat4Batch &b)
+{
+	MAT4_COMPOSE_LOOP(mulScalar)
+}
+
+#ifdef MAT4_X86
+
+MAT4_TARGET("sse2") static void composeSSE2(const Mat4Batch &b)
+{
+	MAT4_COMPOSE_LOOP(mulSSE2)
+}
+
+MAT4_TARGET("avx") static void composeAVX(const Mat4Batch &b)
+{
+	MAT4_COMPOSE_LOOP(mulAVX)
+}
+
+MAT4_TARGET("avx,fma") static void composeFMA(const Mat4Batch &b)
+{
+	MAT4_COMPOSE_LOOP(mulFMA)
+}
+
+#endif // MAT4_X86
+
+void mat4ComposeWith(Mat4Isa isa, const Mat4Batch &batch)
+{
+	switch (isa)
+	{
+#ifdef MAT4_X86
+	case MAT4_SSE2:
+		composeSSE2(batch);
+		break;
+	case MAT4_AVX:
+		composeAVX(batch);
+		break;
+	case MAT4_FMA:
+		composeFMA(batch);
+		break;
+#endif
+	default:
+		composeScalar(batch);
+		break;
+	}
+}
+
+void mat4Compose(const Mat4Batch &batch)
+{
+	mat4ComposeWith(mat4Isa, batch);
+}
+
+//----------------------------------------------------------------------------
+
+float mat4SelfTest(Mat4Isa isa)
+{
+	if (!mat4IsaSupported(isa))
+		return -1.0f;
+
+	const int parts = 27, roots = 8;
+	int parents[parts];
+	Mat4Array locals(parts), rootMats(roots);
+	Mat4Array refWorld(parts * roots), refPvm(parts * roots);
+	Mat4Array world(parts * roots), pvm(parts * roots);
+
+	// fixed seed so that a failure is reproducible
+	struct Lcg
+	{
+		unsigned s;
+		float operator()()
+		{
+			s = s * 1664525u + 1013904223u;
+			return (s >> 8) / 16777216.0f * 2.0f - 1.0f;
+		}
+	} rnd = {12345u};
+
+	for (int p = 0; p < parts; p++)
+	{
+		parents[p] = p == 0 ? -1 : (int)((rnd() * 0.5f + 0.5f) * p);
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(rnd(), rnd(), rnd()));
+		m = glm::rotate(m, rnd() * 3.0f, glm::normalize(glm::vec3(rnd(), rnd(), rnd()) + glm::vec3(0.01f)));
+		locals[p] = glm::scale(m, glm::vec3(0.5f + rnd() * 0.25f));
+	}
+	for (int r = 0; r < roots; r++)
+		rootMats[r] = glm::translate(glm::mat4(1.0f), glm::vec3(rnd(), rnd(), rnd()) * 4.0f);
+
+	glm::mat4 viewProj = glm::perspective(glm::radians(65.0f), 1.0f, 0.1f, 100.0f) *
+						 glm::lookAt(glm::vec3(0, 0, 4), glm::vec3(0), glm::vec3(0, 1, 0));
+
+	Mat4Batch batch = {parts, parents, &locals[0], false, roots, &rootMats[0],
+					   &refWorld[0], &viewProj, &refPvm[0]};
+	mat4ComposeWith(MAT4_SCALAR, batch);
+
+	batch.world = &world[0];
+	batch.pvm = &pvm[0];
+	mat4ComposeWith(isa, batch);
+
+	float maxError = 0.0f;
+	for (size_t i = 0; i < world.size(); i++)
+		for (int c = 0; c < 4; c++)
+			for (int r = 0; r < 4; r++)
+			{
+				maxError = glm::max(maxError, std::fabs(world[i][c][r] - refWorld[i][c][r]));
+				maxError = glm::max(maxError, std::fabs(pvm[i][c][r] - refPvm[i][c][r]));
+			}
+	return maxError;
+}
+
+//----------------------------------------------------------------------------
+
+void *mat4AlignedAlloc(size_t size)
+{
+#ifdef _MSC_VER
+	return _aligned_malloc(size, 32);
+#else
+	void *p;
+	return posix_memalign(&p, 32, size) == 0 ? p : NULL;
+#endif
+}
+
+void mat4AlignedFree(void *p)
+{
+#ifdef _MSC_VER
+	_aligned_free(p);
+#else
+	free(p);
+#endif
+}
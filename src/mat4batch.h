@@ -0,0 +1,102 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _MAT4BATCH_H_
+#define _MAT4BATCH_H_
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Batched matrix composition ---
+//
+//   Builds the world (and optionally projection * view * world) matrix of
+//     every part of one or many elephants in a single call, instead of one
+//     glm operator* at a time.  Parts are attached to their parent part, or to
+//     the elephant's root matrix when the parent is -1, and parents must come
+//     before their children.
+//
+//   The kernel is picked at runtime from what the CPU supports.  The scalar
+//     kernel is the reference the SIMD kernels are validated against.
+//
+
+enum Mat4Isa
+{
+	MAT4_SCALAR,
+	MAT4_SSE2,
+	MAT4_AVX,
+	MAT4_FMA, // AVX + FMA3
+	NumMat4Isas
+};
+
+struct Mat4Batch
+{
+	int partCount;
+	const int *parents;		 // partCount entries, NULL if every part hangs off the root
+	const glm::mat4 *locals; // partCount entries, or partCount per root if localsPerRoot
+	bool localsPerRoot;
+
+	int rootCount;
+	const glm::mat4 *roots; // rootCount entries
+
+	glm::mat4 *world;			// rootCount * partCount results
+	const glm::mat4 *viewProj;	// NULL to skip the pvm results
+	glm::mat4 *pvm;				// rootCount * partCount results
+};
+
+// Kernel used by mat4Compose, the best supported one by default
+extern Mat4Isa mat4Isa;
+
+bool mat4IsaSupported(Mat4Isa isa);
+Mat4Isa mat4BestIsa();
+const char *mat4IsaName(Mat4Isa isa);
+
+void mat4Compose(const Mat4Batch &batch);
+void mat4ComposeWith(Mat4Isa isa, const Mat4Batch &batch);
+
+// Largest absolute difference between isa and the scalar reference on a
+//   batch of random chained poses
+float mat4SelfTest(Mat4Isa isa);
+
+//----------------------------------------------------------------------------
+//
+//   32-byte aligned storage, so the AVX kernels never split a load across
+//     a 32-byte boundary.  A 64-byte matrix may still straddle two cache
+//     lines; only 64-byte alignment would prevent that.
+//
+
+void *mat4AlignedAlloc(size_t size);
+void mat4AlignedFree(void *p);
+
+template <class T>
+struct Mat4Allocator
+{
+	typedef T value_type;
+
+	Mat4Allocator() {}
+	template <class U>
+	Mat4Allocator(const Mat4Allocator<U> &) {}
+
+	T *allocate(size_t n)
+	{
+		void *p = mat4AlignedAlloc(n * sizeof(T));
+		if (p == NULL)
+			throw std::bad_alloc();
+		return static_cast<T *>(p);
+	}
+	void deallocate(T *p, size_t) { mat4AlignedFree(p); }
+
+	template <class U>
+	bool operator==(const Mat4Allocator<U> &) const { return true; }
+	template <class U>
+	bool operator!=(const Mat4Allocator<U> &) const { return false; }
+};
+
+typedef std::vector<glm::mat4, Mat4Allocator<glm::mat4> > Mat4Array;
+
+#endif // _MAT4BATCH_H_
@@ -0,0 +1,206 @@
+//
+// Whole elephant as one mesh skinned to a rigid bone palette
+//
+
+#include <cstddef>
+#include <vector>
+
+#include "camera.h"
+#include "cubemesh.h"
+#include "glstate.h"
+#include "herd.h"
+#include "jobs.h"
+#include "mat4batch.h"
+#include "merged.h"
+#include "profiler.h"
+#include "reflect.h"
+#include "rig.h"
+#include "shaders.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/packing.hpp"
+
+struct MergedVertex
+{
+	glm::vec4 position; // in bone space
+	GLuint color;		// unorm 8:8:8:8
+	GLuint bone;
+};
+
+static int boneCount;
+static int boneParts[NumRigParts]; // rig part of each bone
+
+static BonePaletteMesh mergedMesh;
+static GLuint mergedBuffers[2]; // vertices, indices
+
+// elephants posed per job, as in herdCompose
+static const int paletteGrain = 64;
+
+//----------------------------------------------------------------------------
+
+int mergedBoneCount()
+{
+	return boneCount;
+}
+
+// Uniforms and bindings of the merged program, again after every reload
+static void setupMergedProgram()
+{
+	GLuint program = mergedMesh.program;
+	stateUseProgram(program);
+	reflectSet(program, "bonePalette", 0);
+	reflectSet(program, "boneCount", boneCount);
+	mergedMesh.paletteBase = reflectUniform<int>(program, "paletteBase");
+	cameraBindProgram(program);
+}
+
+void mergedInit()
+{
+	// rest pose locals; the static ones never change
+	RigPose pose;
+	pose.valid = false;
+	rigEvaluate(pose, 0.0f);
+
+	int boneOf[NumRigParts];
+	boneCount = rigBones(boneParts, boneOf);
+
+	glm::vec4 corners[8], cornerColors[8];
+	GLushort triangles[36];
+	cubeMeshCorners(corners, cornerColors, triangles);
+
+	std::vector<MergedVertex> vertices;
+	std::vector<GLushort> indices;
+
+	for (int i = 0; i < NumRigParts; i++)
+	{
+		const RigPart &part = rigParts[i];
+		if (part.scale == glm::vec3(0.0f))
+			continue;
+
+		// static joints between the bone and the part, then the box
+		glm::mat4 boneToPart(1.0f);
+		for (int j = i; j != boneParts[boneOf[i]]; j = rigParts[j].parent)
+			boneToPart = pose.local[j] * boneToPart;
+		glm::mat4 box = glm::scale(boneToPart, part.scale);
+
+		GLushort base = (GLushort)vertices.size();
+		for (int c = 0; c < 8; c++)
+		{
+			MergedVertex v = {box * corners[c], glm::packUnorm4x8(cornerColors[c]), (GLuint)boneOf[i]};
+			vertices.push_back(v);
+		}
+		for (int t = 0; t < 36; t++)
+			indices.push_back(base + triangles[t]);
+	}
+	mergedMesh.indexCount = (GLsizei)indices.size();
+
+	std::cout << "merged: " << NumRigModels << " parts on " << boneCount << " bones, " << vertices.size()
+			  << " vertices, " << indices.size() << " indices" << std::endl;
+
+	mergedMesh.program = InitShader("src/vshader_merged.glsl", "src/fshader.glsl");
+	setupMergedProgram();
+	shaderWatch(mergedMesh.program, setupMergedProgram);
+
+	glGenVertexArrays(1, &mergedMesh.vao);
+	stateBindVertexArray(mergedMesh.vao);
+
+	glGenBuffers(2, mergedBuffers);
+	stateBindBuffer(GL_ARRAY_BUFFER, mergedBuffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(MergedVertex), &vertices[0], GL_STATIC_DRAW);
+	stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mergedBuffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+	// the linker may drop any of them from an edited shader
+	GLint vPosition = reflectAttrib(mergedMesh.program, "vPosition", GL_FLOAT_VEC4);
+	if (vPosition >= 0)
+	{
+		glEnableVertexAttribArray(vPosition);
+		glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, sizeof(MergedVertex),
+							  BUFFER_OFFSET(offsetof(MergedVertex, position)));
+	}
+
+	GLint vColor = reflectAttrib(mergedMesh.program, "vColor", GL_FLOAT_VEC4);
+	if (vColor >= 0)
+	{
+		glEnableVertexAttribArray(vColor);
+		glVertexAttribPointer(vColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(MergedVertex),
+							  BUFFER_OFFSET(offsetof(MergedVertex, color)));
+	}
+
+	GLint vBone = reflectAttrib(mergedMesh.program, "vBone", GL_UNSIGNED_INT);
+	if (vBone >= 0)
+	{
+		glEnableVertexAttribArray(vBone);
+		glVertexAttribIPointer(vBone, 1, GL_UNSIGNED_INT, sizeof(MergedVertex),
+							   BUFFER_OFFSET(offsetof(MergedVertex, bone)));
+	}
+
+	stateBindVertexArray(0);
+
+	ringTextureInit(mergedMesh.texture);
+}
+
+//----------------------------------------------------------------------------
+
+bool mergedDraw(RingBuffer &ring, const glm::mat4 &worldMat, float timeMs)
+{
+	// worldMat * placement * bone world, a matrix per bone
+	return bonePaletteDraw(ring, mergedMesh, boneCount * 4, timeMs, [&](int i, const RigPose &pose, void *palette) {
+		glm::mat4 bones[NumRigParts];
+		for (int b = 0; b < boneCount; b++)
+			bones[b] = pose.world[boneParts[b]];
+
+		glm::mat4 rootMat = worldMat * herdMats[i];
+		Mat4Batch batch = {boneCount, NULL, bones, false, 1, &rootMat, (glm::mat4 *)palette, NULL, NULL};
+		mat4Compose(batch);
+	});
+}
+
+//----------------------------------------------------------------------------
+
+bool bonePaletteDraw(RingBuffer &ring, BonePaletteMesh &mesh, int texels, float timeMs,
+					 const BonePaletteCompose &compose)
+{
+	size_t stride = (size_t)texels * sizeof(glm::vec4);
+	GLsizeiptr size = (GLsizeiptr)(herdSize * stride);
+	GLintptr offset;
+	char *palettes;
+
+	{
+		ProfileScope scope(PROFILE_POSE);
+		ringBeginFrame(ring, size);
+		palettes = (char *)ringAlloc(ring, size, sizeof(glm::vec4), offset);
+		if (palettes)
+		{
+			jobsParallelFor(herdSize, paletteGrain, [&](int begin, int end) {
+				static thread_local RigPose pose;
+				for (int i = begin; i < end; i++)
+				{
+					rigEvaluate(pose, rigWalkCycle(timeMs + herdPhases[i]));
+					compose(i, pose, palettes + i * stride);
+				}
+			});
+		}
+		ringFlush(ring);
+	}
+
+	// no ring memory this frame: nothing to draw, but nothing to fall back
+	//   from either
+	int base = 0;
+	if (palettes)
+	{
+		ProfileScope scope(PROFILE_SUBMIT);
+
+		base = ringTextureBind(mesh.texture, 0, ring, offset, size);
+		if (base >= 0)
+		{
+			stateUseProgram(mesh.program);
+			uniformSet(mesh.paletteBase, base);
+
+			stateBindVertexArray(mesh.vao);
+			glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_SHORT, BUFFER_OFFSET(0), herdSize);
+		}
+	}
+
+	ringEndFrame(ring);
+	return base >= 0;
+}
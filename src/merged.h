@@ -0,0 +1,67 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _MERGED_H_
+#define _MERGED_H_
+
+#include <functional>
+
+#include "cube.h"
+#include "reflect.h"
+#include "rig.h"
+#include "ringbuffer.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Merged rigid-bone elephant ---
+//
+//   Only the parts the walk cycle moves (body, neck, nose segments, thighs,
+//     calves and feet) need a matrix per frame.  Every other part rides
+//     rigidly on its nearest animated ancestor, its bone.  mergedInit()
+//     bakes each part's static chain from the bone down and its box scale
+//     into the vertices of one merged mesh, tagged with the bone index.
+//
+//   A frame then composes one small bone palette per elephant into a
+//     texture buffer view of the frame ring, and one instanced draw renders
+//     the herd: one instance per elephant, so a single elephant is a single
+//     draw call.
+//
+
+// Build the merged mesh and program
+void mergedInit();
+
+// Bones per elephant
+int mergedBoneCount();
+
+// Pose the herd into the ring and draw it; false, drawing nothing, if the
+//   palettes are too big for a texture buffer
+bool mergedDraw(RingBuffer &ring, const glm::mat4 &worldMat, float timeMs);
+
+//----------------------------------------------------------------------------
+//
+//   The skinned elephant (skinned.h) is drawn the same way, with another
+//     mesh and other palettes; both go through bonePaletteDraw().
+//
+
+// A mesh drawn once per elephant, its bones read from bonePalette on
+//   texture unit 0 from texel paletteBase on
+struct BonePaletteMesh
+{
+	GLuint program, vao;
+	GLsizei indexCount; // unsigned short indices
+	UniformHandle<int> paletteBase;
+	RingTexture texture;
+};
+
+// Write the palette of elephant i, posed as pose
+typedef std::function<void(int i, const RigPose &pose, void *palette)> BonePaletteCompose;
+
+// Pose every elephant over the job system into a palette of texels vec4s in
+//   the ring and draw the herd as one instanced draw of mesh; false,
+//   drawing nothing, if the palettes are too big for a texture buffer
+bool bonePaletteDraw(RingBuffer &ring, BonePaletteMesh &mesh, int texels, float timeMs,
+					 const BonePaletteCompose &compose);
+
+#endif // _MERGED_H_
@@ -0,0 +1,252 @@
+//
+// Per-frame CPU and GPU timing with CSV/JSON export
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "cube.h"
+#include "profiler.h"
+
+bool profilerEnabled = false;
+
+struct FrameTimes
+{
+	double intervalMs; // since the start of the previous frame
+	double cpuMs;	   // from profilerBeginFrame to profilerEndFrame
+	double phaseMs[NumProfilePhases];
+	double gpuMs; // -1 until the queries come back, or if they were dropped
+};
+
+static std::vector<FrameTimes> frames;
+static std::chrono::steady_clock::time_point frameStart;
+static bool inFrame = false;
+
+// start/end timestamp queries of the last few frames, used round-robin
+static const int GpuQueryLatency = 4;
+static GLuint gpuQueries[GpuQueryLatency][2];
+static int gpuQueryFrame[GpuQueryLatency]; // frame waiting on the slot, or -1
+
+static const char *phaseNames[NumProfilePhases] = {"pose", "upload", "submit"};
+
+//----------------------------------------------------------------------------
+
+void profilerInit()
+{
+	if (!profilerEnabled)
+		return;
+
+	glGenQueries(GpuQueryLatency * 2, &gpuQueries[0][0]);
+	for (int i = 0; i < GpuQueryLatency; i++)
+		gpuQueryFrame[i] = -1;
+}
+
+// Collect the GPU time of the frame in slot if it is ready, or if wait is set
+static void collectGpu(int slot, bool wait)
+{
+	int frame = gpuQueryFrame[slot];
+	if (frame < 0)
+		return;
+
+	if (!wait)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(gpuQueries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return;
+	}
+
+	GLuint64 begin, end;
+	glGetQueryObjectui64v(gpuQueries[slot][0], GL_QUERY_RESULT, &begin);
+	glGetQueryObjectui64v(gpuQueries[slot][1], GL_QUERY_RESULT, &end);
+	frames[frame].gpuMs = (end - begin) / 1.0e6;
+	gpuQueryFrame[slot] = -1;
+}
+
+void profilerBeginFrame()
+{
+	if (!profilerEnabled)
+		return;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	FrameTimes times;
+	memset(&times, 0, sizeof(times));
+	times.intervalMs = frames.empty() ? 0.0 : std::chrono::duration<double, std::milli>(now - frameStart).count();
+	times.gpuMs = -1.0;
+
+	frameStart = now;
+	inFrame = true;
+
+	int frame = (int)frames.size();
+	frames.push_back(times);
+
+	for (int i = 0; i < GpuQueryLatency; i++)
+		collectGpu(i, false);
+
+	// the slot we need is still in flight: drop that sample rather than wait
+	int slot = frame % GpuQueryLatency;
+	gpuQueryFrame[slot] = frame;
+	glQueryCounter(gpuQueries[slot][0], GL_TIMESTAMP);
+}
+
+void profilerEndFrame()
+{
+	if (!profilerEnabled || !inFrame)
+		return;
+
+	int frame = (int)frames.size() - 1;
+	glQueryCounter(gpuQueries[frame % GpuQueryLatency][1], GL_TIMESTAMP);
+
+	frames[frame].cpuMs =
+		std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+	inFrame = false;
+}
+
+void profilerFinish()
+{
+	if (!profilerEnabled)
+		return;
+
+	for (int i = 0; i < GpuQueryLatency; i++)
+		collectGpu(i, true);
+}
+
+void profilerClear()
+{
+	if (!profilerEnabled)
+		return;
+
+	profilerFinish();
+	frames.clear();
+}
+
+void profilerAddCpu(ProfilePhase phase, double ms)
+{
+	if (inFrame)
+		frames.back().phaseMs[phase] += ms;
+}
+
+//----------------------------------------------------------------------------
+
+// Nearest-rank percentiles, skipping negative (missing) samples
+static ProfilePercentiles percentiles(std::vector<double> &values)
+{
+	values.erase(std::remove_if(values.begin(), values.end(), [](double v) { return v < 0.0; }), values.end());
+
+	ProfilePercentiles p = {(int)values.size(), 0.0, 0.0, 0.0};
+	if (values.empty())
+		return p;
+
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	p.p50 = values[(size_t)std::ceil(0.50 * n) - 1];
+	p.p95 = values[(size_t)std::ceil(0.95 * n) - 1];
+	p.p99 = values[(size_t)std::ceil(0.99 * n) - 1];
+	return p;
+}
+
+// ...of one column, from frame first on
+static ProfilePercentiles percentiles(double FrameTimes::*field, size_t first)
+{
+	std::vector<double> values;
+	for (size_t i = first; i < frames.size(); i++)
+		values.push_back(frames[i].*field);
+	return percentiles(values);
+}
+
+ProfilePercentiles profilerFrameMs()
+{
+	// the first frame has no interval
+	return percentiles(&FrameTimes::intervalMs, 1);
+}
+
+ProfilePercentiles profilerCpuMs()
+{
+	return percentiles(&FrameTimes::cpuMs, 0);
+}
+
+ProfilePercentiles profilerGpuMs()
+{
+	return percentiles(&FrameTimes::gpuMs, 0);
+}
+
+ProfilePercentiles profilerPhaseMs(ProfilePhase phase)
+{
+	std::vector<double> values;
+	for (size_t i = 0; i < frames.size(); i++)
+		values.push_back(frames[i].phaseMs[phase]);
+	return percentiles(values);
+}
+
+void profilerPrintSummary(std::ostream &os)
+{
+	ProfilePercentiles interval = profilerFrameMs();
+	ProfilePercentiles cpu = profilerCpuMs();
+	ProfilePercentiles gpu = profilerGpuMs();
+
+	os << "profile: " << frames.size() << " frames (p50/p95/p99 ms)" << std::endl;
+	os << "  frame " << interval.p50 << " / " << interval.p95 << " / " << interval.p99 << std::endl;
+	os << "  cpu   " << cpu.p50 << " / " << cpu.p95 << " / " << cpu.p99 << std::endl;
+	os << "  gpu   " << gpu.p50 << " / " << gpu.p95 << " / " << gpu.p99 << " (" << gpu.count << " samples)"
+	   << std::endl;
+}
+
+static void writeJsonPercentiles(std::ofstream &out, const char *name, const ProfilePercentiles &p, bool last)
+{
+	out << "    \"" << name << "\": {\"samples\": " << p.count << ", \"p50\": " << p.p50 << ", \"p95\": " << p.p95
+		<< ", \"p99\": " << p.p99 << "}" << (last ? "\n" : ",\n");
+}
+
+bool profilerWrite(const char *path)
+{
+	std::ofstream out(path);
+	if (!out)
+	{
+		std::cerr << "profile: cannot write " << path << std::endl;
+		return false;
+	}
+
+	size_t len = strlen(path);
+	bool json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+
+	if (json)
+	{
+		out << "{\n  \"frames\": [\n";
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			const FrameTimes &t = frames[i];
+			out << "    {\"frame\": " << i << ", \"interval_ms\": " << t.intervalMs << ", \"cpu_ms\": " << t.cpuMs;
+			for (int p = 0; p < NumProfilePhases; p++)
+				out << ", \"" << phaseNames[p] << "_ms\": " << t.phaseMs[p];
+			out << ", \"gpu_ms\": " << t.gpuMs << "}" << (i + 1 < frames.size() ? ",\n" : "\n");
+		}
+		out << "  ],\n  \"summary\": {\n";
+		writeJsonPercentiles(out, "frame_ms", profilerFrameMs(), false);
+		writeJsonPercentiles(out, "cpu_ms", profilerCpuMs(), false);
+		writeJsonPercentiles(out, "gpu_ms", profilerGpuMs(), true);
+		out << "  }\n}\n";
+	}
+	else
+	{
+		out << "frame,interval_ms,cpu_ms";
+		for (int p = 0; p < NumProfilePhases; p++)
+			out << "," << phaseNames[p] << "_ms";
+		out << ",gpu_ms\n";
+
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			const FrameTimes &t = frames[i];
+			out << i << "," << t.intervalMs << "," << t.cpuMs;
+			for (int p = 0; p < NumProfilePhases; p++)
+				out << "," << t.phaseMs[p];
+			out << "," << t.gpuMs << "\n";
+		}
+	}
+
+	return (bool)out;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <chrono>
+#include <iostream>
+
+//----------------------------------------------------------------------------
+//
+//  --- Frame profiler ---
+//
+//   Collects, per frame, the CPU time of each phase of display() and the GPU
+//     time between a pair of GL_TIMESTAMP queries at the start and end of
+//     the frame.  Query results are picked up a few frames later, once the
+//     GPU has them, so reading them never stalls the pipeline; a result that
+//     is still not available when its query is reused is dropped.
+//
+//   Nothing is recorded unless profilerEnabled is set before profilerInit().
+//
+
+enum ProfilePhase
+{
+	PROFILE_POSE,	// pose evaluation and matrix composition
+	PROFILE_UPLOAD, // per-frame buffer and uniform uploads
+	PROFILE_SUBMIT, // draw calls
+	NumProfilePhases
+};
+
+extern bool profilerEnabled;
+
+// Create the GPU queries; needs a current context
+void profilerInit();
+
+// Bracket the GL work of one frame
+void profilerBeginFrame();
+void profilerEndFrame();
+
+// Wait for the outstanding GPU results, e.g. before writing a report
+void profilerFinish();
+
+// Finish and drop the frames so far, e.g. warm-up frames
+void profilerClear();
+
+void profilerAddCpu(ProfilePhase phase, double ms);
+
+// Write every frame as CSV, or as JSON with a summary if path ends in .json
+bool profilerWrite(const char *path);
+
+// p50/p95/p99 of frame interval, CPU and GPU time
+void profilerPrintSummary(std::ostream &os);
+
+// Nearest-rank percentiles over the frames that have a sample
+struct ProfilePercentiles
+{
+	int count;
+	double p50, p95, p99;
+};
+
+ProfilePercentiles profilerFrameMs(); // interval, from the second frame on
+ProfilePercentiles profilerCpuMs();
+ProfilePercentiles profilerGpuMs();
+ProfilePercentiles profilerPhaseMs(ProfilePhase phase); // CPU time in one phase
+
+// Adds the lifetime of the object to a phase of the current frame
+class ProfileScope
+{
+public:
+	explicit ProfileScope(ProfilePhase phase)
+		: phase(phase), start(std::chrono::steady_clock::now()) {}
+
+	~ProfileScope()
+	{
+		if (profilerEnabled)
+		{
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			profilerAddCpu(phase, elapsed.count());
+		}
+	}
+
+private:
+	ProfilePhase phase;
+	std::chrono::steady_clock::time_point start;
+};
+
+#endif // _PROFILER_H_
@@ -0,0 +1,188 @@
+//
+// Linked programs kept on disk between runs
+//
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#  include <direct.h>
+#else
+#  include <sys/stat.h>
+#endif
+
+#include "programcache.h"
+
+bool programCacheEnabled = true;
+const char *programCacheDir = "shadercache";
+
+static const uint32_t cacheMagic = 0x42504345; // "ECPB"
+
+struct CacheHeader
+{
+	uint32_t magic;
+	uint32_t format; // binary format GLenum
+	uint32_t size;	 // bytes of binary following
+};
+
+static int loaded, compiled, rejected;
+static double loadedMs, compiledMs;
+
+//----------------------------------------------------------------------------
+
+bool programCacheActive()
+{
+	static int supported = -1;
+	if (supported < 0)
+	{
+		GLint formats = 0;
+		supported = GLVersion() >= 41 || HasGLExtension("GL_ARB_get_program_binary");
+		if (supported)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		supported = formats > 0;
+	}
+	return programCacheEnabled && supported;
+}
+
+uint64_t programCacheHash(const void *data, size_t size, uint64_t hash)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for (size_t i = 0; i < size; i++)
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	return hash;
+}
+
+static uint64_t hashString(const char *s, uint64_t hash)
+{
+	// include the terminator so "ab" + "c" differs from "a" + "bc"
+	return programCacheHash(s ? s : "", s ? strlen(s) + 1 : 1, hash);
+}
+
+uint64_t programCacheKey(const uint64_t *sourceKeys, int count)
+{
+	uint64_t hash = ProgramCacheHashSeed;
+	hash = hashString((const char *)glGetString(GL_VENDOR), hash);
+	hash = hashString((const char *)glGetString(GL_RENDERER), hash);
+	hash = hashString((const char *)glGetString(GL_VERSION), hash);
+	return programCacheHash(sourceKeys, count * sizeof(uint64_t), hash);
+}
+
+static std::string cachePath(uint64_t key)
+{
+	char name[32];
+	sprintf(name, "/%016llx.bin", (unsigned long long)key);
+	return std::string(programCacheDir) + name;
+}
+
+//----------------------------------------------------------------------------
+
+bool programCacheLoad(GLuint program, uint64_t key)
+{
+	if (!programCacheActive())
+		return false;
+
+	FILE *fp = fopen(cachePath(key).c_str(), "rb");
+	if (fp == NULL)
+		return false;
+
+	CacheHeader header;
+	std::vector<unsigned char> binary;
+	bool read = fread(&header, sizeof(header), 1, fp) == 1 && header.magic == cacheMagic;
+	if (read)
+	{
+		binary.resize(header.size);
+		read = header.size > 0 && fread(&binary[0], 1, header.size, fp) == header.size;
+	}
+	fclose(fp);
+
+	GLint linked = GL_FALSE;
+	if (read)
+	{
+		glProgramBinary(program, header.format, &binary[0], (GLsizei)header.size);
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	}
+	if (!linked)
+		rejected++;
+	return linked == GL_TRUE;
+}
+
+void programCacheStore(GLuint program, uint64_t key)
+{
+	if (!programCacheActive())
+		return;
+
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0)
+		return;
+
+	CacheHeader header;
+	std::vector<unsigned char> binary(size);
+	GLenum format;
+	glGetProgramBinary(program, size, NULL, &format, &binary[0]);
+	header.magic = cacheMagic;
+	header.format = format;
+	header.size = (uint32_t)size;
+
+#ifdef _WIN32
+	_mkdir(programCacheDir);
+#else
+	mkdir(programCacheDir, 0755);
+#endif
+
+	// write beside and rename, so a crash or another instance never leaves
+	//   a torn file under the key
+	std::string path = cachePath(key), temp = path + ".tmp";
+	FILE *fp = fopen(temp.c_str(), "wb");
+	if (fp == NULL)
+	{
+		std::cerr << "program cache: cannot write " << temp << std::endl;
+		return;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, fp) == 1 && fwrite(&binary[0], 1, size, fp) == (size_t)size;
+	written = fclose(fp) == 0 && written;
+
+	remove(path.c_str());
+	if (!written || rename(temp.c_str(), path.c_str()) != 0)
+	{
+		std::cerr << "program cache: cannot write " << path << std::endl;
+		remove(temp.c_str());
+	}
+}
+
+//----------------------------------------------------------------------------
+
+void programCacheRecord(double ms, bool cached)
+{
+	if (cached)
+	{
+		loaded++;
+		loadedMs += ms;
+	}
+	else
+	{
+		compiled++;
+		compiledMs += ms;
+	}
+}
+
+void programCacheReport(std::ostream &os)
+{
+	os << "shaders: " << loaded + compiled << " programs in " << loadedMs + compiledMs << " ms, ";
+	if (!programCacheActive())
+	{
+		os << (programCacheEnabled ? "no program binary support, cache off" : "cache off") << std::endl;
+		return;
+	}
+	os << loaded << " from cache";
+	if (loaded > 0)
+		os << " (" << loadedMs / loaded << " ms each)";
+	os << ", " << compiled << " compiled";
+	if (compiled > 0)
+		os << " (" << compiledMs / compiled << " ms each)";
+	if (rejected > 0)
+		os << ", " << rejected << " cached binaries rejected";
+	os << std::endl;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _PROGRAMCACHE_H_
+#define _PROGRAMCACHE_H_
+
+#include <iostream>
+#include <stdint.h>
+
+#include "cube.h"
+
+//----------------------------------------------------------------------------
+//
+//  --- Program binary cache ---
+//
+//   Linking, not reading the files, is most of startup on a software driver,
+//     so linked programs are kept on disk as glGetProgramBinary() output in
+//     programCacheDir, one file per key.  The key hashes the shader sources,
+//     the defines they were built with and the GL vendor, renderer and
+//     version strings, so an edited shader or a driver update misses instead
+//     of loading a stale binary.
+//
+//   A driver may still refuse a binary it wrote, e.g. after an update that
+//     kept its version string; the program is then compiled from source as
+//     if there were no cache and the file is replaced.
+//
+//   Program binaries need GL 4.1 or ARB_get_program_binary and at least one
+//     binary format; without them the cache stays off.
+//
+
+extern bool programCacheEnabled; // off with -noshadercache
+extern const char *programCacheDir;
+
+// Enabled and supported by the context; needs a current context
+bool programCacheActive();
+
+// FNV-1a, 64 bit; pass the previous hash to continue one
+const uint64_t ProgramCacheHashSeed = 0xcbf29ce484222325ull;
+uint64_t programCacheHash(const void *data, size_t size, uint64_t hash = ProgramCacheHashSeed);
+
+// Key of a program from the keys of its shader sources, which cover their
+//   defines; needs a current context
+uint64_t programCacheKey(const uint64_t *sourceKeys, int count);
+
+// Load the binary stored under key into program, true if it linked
+bool programCacheLoad(GLuint program, uint64_t key);
+
+// Store a linked program, which must have been linked with
+//   GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void programCacheStore(GLuint program, uint64_t key);
+
+// Time spent building a program, and whether it came from the cache
+void programCacheRecord(double ms, bool cached);
+
+// Programs loaded, compiled and rejected, and the time each took
+void programCacheReport(std::ostream &os);
+
+#endif // _PROGRAMCACHE_H_
@@ -0,0 +1,236 @@
+//
+// Active uniforms, attributes and blocks of every linked program
+//
+
+#include <cstdlib>
+#include <map>
+
+#include "reflect.h"
+
+enum ReflectKind
+{
+	REFLECT_UNIFORM,
+	REFLECT_ATTRIB,
+	REFLECT_BLOCK
+};
+
+struct ReflectedVariable
+{
+	ReflectKind kind;
+	std::string name;
+	GLint location; // uniform or attribute location, block index
+	GLenum type;	// 0 for blocks
+	GLint size;		// array length; bytes for blocks
+	GLint block;	// block of a uniform, -1 for the default block
+	size_t shadow;	// offset of the value in ProgramReflection::shadow
+};
+
+struct ProgramReflection
+{
+	std::vector<ReflectedVariable> variables;
+	std::vector<unsigned char> shadow; // sized once, so handles stay valid
+};
+
+static std::map<GLuint, ProgramReflection> programs;
+
+//----------------------------------------------------------------------------
+
+static bool isSampler(GLenum type)
+{
+	switch (type)
+	{
+	case GL_SAMPLER_1D:
+	case GL_SAMPLER_2D:
+	case GL_SAMPLER_3D:
+	case GL_SAMPLER_CUBE:
+	case GL_SAMPLER_BUFFER:
+	case GL_INT_SAMPLER_BUFFER:
+	case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Bytes of a uniform of type whose value the shadow can hold
+static size_t shadowSize(GLenum type)
+{
+	if (isSampler(type))
+		return 4; // the texture unit
+
+	switch (type)
+	{
+	case GL_FLOAT_VEC4:
+		return sizeof(glm::vec4);
+	case GL_FLOAT_MAT4:
+		return sizeof(glm::mat4);
+	case GL_FLOAT:
+	case GL_INT:
+	case GL_UNSIGNED_INT:
+	case GL_BOOL:
+		return 4;
+	default:
+		return 0; // no handles for these
+	}
+}
+
+// Whether a C++ value of type wanted can be uploaded to a GLSL uniform of
+//   type actual
+static bool typeMatches(GLenum wanted, GLenum actual)
+{
+	if (wanted == actual)
+		return true;
+	return wanted == GL_INT && (actual == GL_BOOL || isSampler(actual));
+}
+
+static const char *kindName(ReflectKind kind)
+{
+	static const char *names[] = {"uniform", "attribute", "uniform block"};
+	return names[kind];
+}
+
+static const ReflectedVariable *findVariable(GLuint program, ReflectKind kind, const char *name,
+											 ProgramReflection **reflection = NULL)
+{
+	std::map<GLuint, ProgramReflection>::iterator p = programs.find(program);
+	if (p == programs.end())
+		return NULL;
+
+	if (reflection)
+		*reflection = &p->second;
+	for (size_t i = 0; i < p->second.variables.size(); i++)
+	{
+		const ReflectedVariable &v = p->second.variables[i];
+		if (v.kind == kind && v.name == name)
+			return &v;
+	}
+	return NULL;
+}
+
+static void mismatch(GLuint program, ReflectKind kind, const char *name, const char *what)
+{
+	std::cerr << kindName(kind) << " " << name << " of program " << program << " " << what << std::endl;
+	exit(EXIT_FAILURE);
+}
+
+//----------------------------------------------------------------------------
+
+void reflectProgram(GLuint program)
+{
+	ProgramReflection &reflection = programs[program];
+	reflection.variables.clear();
+
+	GLint count = 0, maxLength = 0;
+	std::vector<char> name;
+
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	name.resize(maxLength + 1);
+
+	size_t shadowBytes = 0;
+	for (GLint i = 0; i < count; i++)
+	{
+		ReflectedVariable v;
+		GLuint index = (GLuint)i;
+		v.kind = REFLECT_UNIFORM;
+		glGetActiveUniform(program, index, (GLsizei)name.size(), NULL, &v.size, &v.type, &name[0]);
+		glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &v.block);
+		v.name = &name[0];
+		v.location = v.block < 0 ? glGetUniformLocation(program, &name[0]) : -1;
+		v.shadow = shadowBytes;
+		if (v.location >= 0 && v.size == 1)
+			shadowBytes += shadowSize(v.type);
+		reflection.variables.push_back(v);
+	}
+
+	// the values the program starts with; only set ones are skipped later
+	reflection.shadow.assign(shadowBytes, 0);
+	for (size_t i = 0; i < reflection.variables.size(); i++)
+	{
+		const ReflectedVariable &v = reflection.variables[i];
+		if (v.location < 0 || v.size != 1 || shadowSize(v.type) == 0)
+			continue;
+
+		void *value = &reflection.shadow[v.shadow];
+		if (v.type == GL_UNSIGNED_INT)
+			glGetUniformuiv(program, v.location, (GLuint *)value);
+		else if (v.type == GL_INT || v.type == GL_BOOL || isSampler(v.type))
+			glGetUniformiv(program, v.location, (GLint *)value);
+		else
+			glGetUniformfv(program, v.location, (GLfloat *)value);
+	}
+
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+	name.resize(maxLength + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		ReflectedVariable v;
+		v.kind = REFLECT_ATTRIB;
+		glGetActiveAttrib(program, (GLuint)i, (GLsizei)name.size(), NULL, &v.size, &v.type, &name[0]);
+		v.name = &name[0];
+		v.location = glGetAttribLocation(program, &name[0]);
+		v.block = -1;
+		v.shadow = 0;
+		reflection.variables.push_back(v);
+	}
+
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+	name.resize(maxLength + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		ReflectedVariable v;
+		v.kind = REFLECT_BLOCK;
+		glGetActiveUniformBlockName(program, (GLuint)i, (GLsizei)name.size(), NULL, &name[0]);
+		glGetActiveUniformBlockiv(program, (GLuint)i, GL_UNIFORM_BLOCK_DATA_SIZE, &v.size);
+		v.name = &name[0];
+		v.location = i;
+		v.type = 0;
+		v.block = -1;
+		v.shadow = 0;
+		reflection.variables.push_back(v);
+	}
+}
+
+void reflectForget(GLuint program)
+{
+	programs.erase(program);
+}
+
+//----------------------------------------------------------------------------
+
+void *reflectUniformShadow(GLuint program, const char *name, GLenum type, GLint &location)
+{
+	ProgramReflection *reflection;
+	const ReflectedVariable *v = findVariable(program, REFLECT_UNIFORM, name, &reflection);
+
+	location = -1;
+	if (v == NULL || v->location < 0)
+		return NULL;
+	if (!typeMatches(type, v->type) || v->size != 1)
+		mismatch(program, REFLECT_UNIFORM, name, "does not have the type it is set with");
+
+	location = v->location;
+	return &reflection->shadow[v->shadow];
+}
+
+GLint reflectAttrib(GLuint program, const char *name, GLenum type)
+{
+	const ReflectedVariable *v = findVariable(program, REFLECT_ATTRIB, name);
+	if (v == NULL)
+		return -1;
+	if (v->type != type)
+		mismatch(program, REFLECT_ATTRIB, name, "does not have the type of its vertex data");
+	return v->location;
+}
+
+GLuint reflectBlock(GLuint program, const char *name, GLsizeiptr size)
+{
+	const ReflectedVariable *v = findVariable(program, REFLECT_BLOCK, name);
+	if (v == NULL)
+		return GL_INVALID_INDEX;
+	if (v->size != size)
+		mismatch(program, REFLECT_BLOCK, name, "is not the size of the struct uploaded to it");
+	return (GLuint)v->location;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _REFLECT_H_
+#define _REFLECT_H_
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cube.h"
+#include "glstate.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Program reflection ---
+//
+//   Every program is enumerated once, right after it links: its active
+//     uniforms, attributes and uniform blocks go into one flat table per
+//     program.  Code asks the table, not GL, for what it needs, and asks
+//     once, at setup: reflectUniform<T>() returns a handle typed by the C++
+//     value it takes, and reflectAttrib() and reflectBlock() check the
+//     attribute type or block size the caller is about to rely on.  A
+//     mismatch with the shader is reported and ends the program, as a shader
+//     that fails to compile does.
+//
+//   The table keeps the current value of each default-block uniform, read
+//     back from GL at link time.  uniformSet() only calls glUniform* when
+//     the value differs, so uploading the same matrix every draw is free;
+//     what it skips is counted by the state cache (glstate.h).
+//     The program of the handle must be current, as for glUniform*.
+//
+//   A name the linker removed is not an error: its handle and location are
+//     -1 and setting it does nothing, as in GL.
+//
+
+// GLSL type a C++ uniform value stands for
+template <typename T>
+struct ReflectType;
+
+template <> struct ReflectType<float> { static const GLenum type = GL_FLOAT; };
+template <> struct ReflectType<int> { static const GLenum type = GL_INT; };	// also bool, samplers
+template <> struct ReflectType<GLuint> { static const GLenum type = GL_UNSIGNED_INT; };
+template <> struct ReflectType<glm::vec4> { static const GLenum type = GL_FLOAT_VEC4; };
+template <> struct ReflectType<glm::mat4> { static const GLenum type = GL_FLOAT_MAT4; };
+
+template <typename T>
+struct UniformHandle
+{
+	GLint location;
+	T *shadow; // value last uploaded, in the program's table
+
+	UniformHandle() : location(-1), shadow(NULL) {}
+};
+
+// Enumerate a linked program, and forget it again before it is deleted
+void reflectProgram(GLuint program);
+void reflectForget(GLuint program);
+
+// Shadow value of a default-block uniform of type, NULL (after reporting
+//   any type mismatch) if there is none
+void *reflectUniformShadow(GLuint program, const char *name, GLenum type, GLint &location);
+
+template <typename T>
+UniformHandle<T> reflectUniform(GLuint program, const char *name)
+{
+	UniformHandle<T> handle;
+	handle.shadow = (T *)reflectUniformShadow(program, name, ReflectType<T>::type, handle.location);
+	return handle;
+}
+
+// Location of an attribute that must have type, -1 if it is not active
+GLint reflectAttrib(GLuint program, const char *name, GLenum type);
+
+// Index of a uniform block that must be size bytes, GL_INVALID_INDEX if
+//   the program has none of that name
+GLuint reflectBlock(GLuint program, const char *name, GLsizeiptr size);
+
+//----------------------------------------------------------------------------
+
+inline void uniformUpload(GLint location, float value) { glUniform1f(location, value); }
+inline void uniformUpload(GLint location, int value) { glUniform1i(location, value); }
+inline void uniformUpload(GLint location, GLuint value) { glUniform1ui(location, value); }
+inline void uniformUpload(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, &value[0]); }
+inline void uniformUpload(GLint location, const glm::mat4 &value)
+{
+	glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+}
+
+// Upload value unless the program already has it
+template <typename T>
+inline void uniformSet(const UniformHandle<T> &handle, const T &value)
+{
+	if (handle.location < 0)
+		return;
+
+	// bytes, not ==, so -0 and NaN are uploaded as given
+	if (!stateCount(STATE_UNIFORM, memcmp(handle.shadow, &value, sizeof(T)) == 0))
+		return;
+
+	memcpy(handle.shadow, &value, sizeof(T));
+	uniformUpload(handle.location, value);
+}
+
+// Look up and set in one go, for setup code; the program must be current
+template <typename T>
+inline void reflectSet(GLuint program, const char *name, const T &value)
+{
+	uniformSet(reflectUniform<T>(program, name), value);
+}
+
+#endif // _REFLECT_H_
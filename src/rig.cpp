@@ -0,0 +1,165 @@
+//
+// Elephant skeleton as data
+//
+// Each entry used to be a hand-written matrix chain in drawBody(), drawHead()
+//   and drawLeg().  The table is ordered so that parents precede children.
+
+#include <iostream>
+
+#include "rig.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+#define NO_ROT 0.0f, glm::vec3(0.0f)
+#define NO_PIVOT glm::vec3(0.0f)
+#define NO_ANIM 0.0f, glm::vec3(0.0f)
+#define NO_DRAW glm::vec3(0.0f)
+
+// one leg starting at table index base: thigh, knee, calf and foot
+#define LEG(side, base, x, y, dir) \
+	{"thigh " side, 0, glm::vec3(x, y, -0.4f), NO_ROT, glm::vec3(0, 0, 0.5f), -60.0f * dir, glm::vec3(0, 1, 0), \
+	 glm::vec3(0.5f, 0.5f, 0.5f)}, \
+	{"knee " side, base, glm::vec3(0, 0, -0.25f), NO_ROT, NO_PIVOT, NO_ANIM, glm::vec3(0.45f, 0.375f, 0.2f)}, \
+	{"calf " side, base + 1, glm::vec3(0, 0, -0.31f), NO_ROT, glm::vec3(0, 0, 0.5f), -50.0f * dir, glm::vec3(0, 1, 0), \
+	 glm::vec3(0.35f, 0.35f, 0.5f)}, \
+	{"foot " side, base + 2, glm::vec3(0.025f, 0, -0.25f), NO_ROT, NO_PIVOT, -75.0f * dir, glm::vec3(0, 1, 0), \
+	 glm::vec3(0.5f, 0.36f, 0.175f)}
+
+const RigPart rigParts[NumRigParts] = {
+	// 몸통
+	{"body", -1, glm::vec3(0), NO_ROT, NO_PIVOT, -10.0f, glm::vec3(1, 0, 0), glm::vec3(1.4f, 1.0f, 0.9f)},
+	// 꼬리
+	{"tail", 0, glm::vec3(-0.8f, 0, 0), 0.35f, glm::vec3(0, 1, 0), NO_PIVOT, NO_ANIM, glm::vec3(0.1f, 0.1f, 0.75f)},
+
+	// 목 관절
+	{"neck", 0, glm::vec3(0.25f, 0, -0.2f), NO_ROT, NO_PIVOT, 35.0f, glm::vec3(1, 0, 0), NO_DRAW},
+	// 머리
+	{"head", 2, glm::vec3(0.75f, 0, 0.45f), -0.25f, glm::vec3(0, 1, 0), NO_PIVOT, NO_ANIM, glm::vec3(0.65f, 0.6f, 0.65f)},
+	// 귀
+	{"ear right", 2, glm::vec3(0.7f, 0.5f, 0.45f), -0.25f, glm::vec3(1, 1, -1), NO_PIVOT, NO_ANIM,
+	 glm::vec3(0.125f, 0.65f, 0.65f)},
+	{"ear left", 2, glm::vec3(0.7f, -0.5f, 0.45f), -0.25f, glm::vec3(-1, 1, 1), NO_PIVOT, NO_ANIM,
+	 glm::vec3(0.125f, 0.65f, 0.65f)},
+	// 상아
+	{"tusk right", 2, glm::vec3(0.8f, 0.275f, 0), -0.35f, glm::vec3(-1, 1, -1), NO_PIVOT, NO_ANIM,
+	 glm::vec3(0.1f, 0.1f, 0.65f)},
+	{"tusk left", 2, glm::vec3(0.8f, -0.275f, 0), -0.35f, glm::vec3(1, 1, 1), NO_PIVOT, NO_ANIM,
+	 glm::vec3(0.1f, 0.1f, 0.65f)},
+	// 코
+	{"nose 1", 2, glm::vec3(0.85f, 0, 0), NO_ROT, NO_PIVOT, -35.0f, glm::vec3(0, 0, 1), glm::vec3(0.45f, 0.45f, 0.65f)},
+	{"nose 2", 8, glm::vec3(0, 0, -0.5f), 0.1f, glm::vec3(0, 1, 0), NO_PIVOT, -35.0f, glm::vec3(0, 0, 1),
+	 glm::vec3(0.35f, 0.35f, 0.45f)},
+	{"nose 3", 9, glm::vec3(0, 0, -0.3f), 0.15f, glm::vec3(0, 1, 0), NO_PIVOT, -35.0f, glm::vec3(0, 0, 1),
+	 glm::vec3(0.225f, 0.225f, 0.4f)},
+
+	// 다리: 허벅지, 무릎, 종아리, 발
+	LEG("rear right", 11, 0.6f, 0.4f, 1),
+	LEG("rear left", 15, 0.6f, -0.4f, -1),
+	LEG("front right", 19, -0.6f, 0.4f, -1),
+	LEG("front left", 23, -0.6f, -0.4f, 1),
+};
+
+//----------------------------------------------------------------------------
+
+static glm::mat4 localTransform(const RigPart &part, float angle)
+{
+	glm::mat4 m = glm::translate(glm::mat4(1.0f), part.offset);
+
+	if (part.restAngle != 0.0f)
+		m = glm::rotate(m, part.restAngle, part.restAxis);
+
+	if (part.animGain != 0.0f)
+	{
+		m = glm::translate(m, part.pivot);
+		m = glm::rotate(m, part.animGain * angle, part.animAxis);
+		m = glm::translate(m, -part.pivot);
+	}
+
+	return m;
+}
+
+//----------------------------------------------------------------------------
+
+bool rigValidate()
+{
+	int drawn = 0;
+
+	for (int i = 0; i < NumRigParts; i++)
+	{
+		int parent = rigParts[i].parent;
+		if (parent >= i || (i > 0 && parent < 0))
+		{
+			std::cerr << "rig part " << rigParts[i].name << " does not follow its parent" << std::endl;
+			return false;
+		}
+		if (rigParts[i].scale != glm::vec3(0.0f))
+			drawn++;
+	}
+
+	if (drawn != NumRigModels)
+	{
+		std::cerr << "rig has " << drawn << " drawn parts, expected " << NumRigModels << std::endl;
+		return false;
+	}
+	return true;
+}
+
+float rigWalkCycle(float timeMs)
+{
+	return glm::radians(cos(timeMs / 100.0f) * 360.0f / 2000.0f);
+}
+
+int rigBones(int boneParts[NumRigParts], int boneOf[NumRigParts])
+{
+	int boneCount = 0;
+
+	for (int i = 0; i < NumRigParts; i++)
+	{
+		if (rigParts[i].parent < 0 || rigParts[i].animGain != 0.0f)
+		{
+			boneOf[i] = boneCount;
+			boneParts[boneCount++] = i;
+		}
+		else
+			boneOf[i] = boneOf[rigParts[i].parent];
+	}
+
+	return boneCount;
+}
+
+bool rigEvaluate(RigPose &pose, float angle)
+{
+	bool first = !pose.valid;
+	if (!first && pose.angle == angle)
+		return false;
+
+	bool dirty[NumRigParts];
+	int slot = 0;
+
+	for (int i = 0; i < NumRigParts; i++)
+	{
+		const RigPart &part = rigParts[i];
+		int parent = part.parent;
+
+		// static parts keep the local transform computed on the first pass
+		bool localDirty = first || part.animGain != 0.0f;
+		if (localDirty)
+			pose.local[i] = localTransform(part, angle);
+
+		bool drawn = part.scale != glm::vec3(0.0f);
+
+		dirty[i] = localDirty || (parent >= 0 && dirty[parent]);
+		if (dirty[i])
+		{
+			pose.world[i] = parent >= 0 ? pose.world[parent] * pose.local[i] : pose.local[i];
+			if (drawn)
+				pose.model[slot] = glm::scale(pose.world[i], part.scale);
+		}
+
+		if (drawn)
+			slot++;
+	}
+
+	pose.valid = true;
+	pose.angle = angle;
+	return true;
+}
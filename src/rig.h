@@ -0,0 +1,81 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _RIG_H_
+#define _RIG_H_
+
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Elephant rig ---
+//
+//   The elephant skeleton is a flat table of parts.  Each part names its
+//     parent, which always comes earlier in the table, so a single forward
+//     pass visits parents before children and every shared prefix of the
+//     matrix chain is computed exactly once.
+//
+//   A part's local transform relative to its parent joint is
+//
+//     translate(offset) * rotate(restAngle, restAxis)
+//       * translate(pivot) * rotate(animGain * angle, animAxis) * translate(-pivot)
+//
+//     where angle is the walk cycle value (rotAngleLeg).  The box that gets
+//     drawn is the joint scaled by scale; the scale is not inherited by
+//     children.  Parts with a zero scale are pure joints and are not drawn.
+//
+
+struct RigPart
+{
+	const char *name;
+	int parent; // index of the parent part, -1 for the root
+
+	glm::vec3 offset;
+	float restAngle;
+	glm::vec3 restAxis;
+
+	glm::vec3 pivot;
+	float animGain; // 0 for parts that never move relative to their parent
+	glm::vec3 animAxis;
+
+	glm::vec3 scale;
+};
+
+const int NumRigParts = 27;
+const int NumRigModels = 26; // parts that are drawn
+
+extern const RigPart rigParts[NumRigParts];
+
+// Cached pose of one elephant, relative to the elephant's root
+struct RigPose
+{
+	bool valid;
+	float angle; // walk cycle value the cache was built for
+
+	glm::mat4 local[NumRigParts];
+	glm::mat4 world[NumRigParts];
+
+	// world * scale of the drawn parts only, packed in table order
+	glm::mat4 model[NumRigModels];
+};
+
+// Check that every part's parent precedes it in the table
+bool rigValidate();
+
+// Walk cycle value (rotAngleLeg) at the given animation time in ms
+float rigWalkCycle(float timeMs);
+
+// The walk cycle repeats every 200 * pi ms
+const float RigWalkPeriod = 628.318531f;
+
+// Split the rig into bones: the root and every animated part start one, and
+//   every other part rides on its parent's bone.  Fills the part each bone
+//   starts at and the bone of each part; returns the bone count.
+int rigBones(int boneParts[NumRigParts], int boneOf[NumRigParts]);
+
+// Bring pose up to date for the given walk cycle value.  Only animated parts
+//   and their descendants are recomputed; returns false if nothing changed.
+bool rigEvaluate(RigPose &pose, float angle);
+
+#endif // _RIG_H_
@@ -0,0 +1,212 @@
+//
+// Fenced, triple-buffered upload ring
+//
+
+#include "glstate.h"
+#include "ringbuffer.h"
+
+bool ringForceFallback = false;
+
+//----------------------------------------------------------------------------
+
+static bool createStorage(RingBuffer &ring, GLsizeiptr regionSize)
+{
+	GLsizeiptr size = regionSize * RingFrames;
+
+	ring.regionSize = regionSize;
+	ring.generation++;
+	ring.persistent = !ringForceFallback && (GLVersion() >= 44 || HasGLExtension("GL_ARB_buffer_storage"));
+	ring.mapped = NULL;
+	ring.regionMapped = NULL;
+
+	glGenBuffers(1, &ring.buffer);
+	stateBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+
+	if (ring.persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+		ring.mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+		if (ring.mapped == NULL)
+		{
+			std::cerr << "ring: persistent mapping failed" << std::endl;
+			return false;
+		}
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+	}
+
+	for (int i = 0; i < RingFrames; i++)
+		ring.fences[i] = 0;
+	ring.region = RingFrames - 1;
+	ring.head = 0;
+	return true;
+}
+
+bool ringInit(RingBuffer &ring, GLsizeiptr regionSize)
+{
+	ring.waits = 0;
+	ring.generation = 0;
+	if (!createStorage(ring, regionSize))
+		return false;
+
+	std::cout << "ring: " << RingFrames << " x " << regionSize / 1024 << " KB, "
+			  << (ring.persistent ? "persistent mapping" : "unsynchronized mapping") << std::endl;
+	return true;
+}
+
+void ringDestroy(RingBuffer &ring)
+{
+	for (int i = 0; i < RingFrames; i++)
+	{
+		if (ring.fences[i])
+		{
+			glClientWaitSync(ring.fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+			glDeleteSync(ring.fences[i]);
+			ring.fences[i] = 0;
+		}
+	}
+
+	if (ring.persistent && ring.mapped)
+	{
+		stateBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	}
+	glDeleteBuffers(1, &ring.buffer);
+	stateReset(); // GL unbound it everywhere
+	ring.buffer = 0;
+	ring.mapped = NULL;
+	ring.regionMapped = NULL;
+}
+
+//----------------------------------------------------------------------------
+
+bool ringBeginFrame(RingBuffer &ring, GLsizeiptr frameSize)
+{
+	// a bigger herd than the ring was sized for: drain it and start over
+	if (frameSize > ring.regionSize)
+	{
+		GLsizeiptr regionSize = ring.regionSize;
+		while (regionSize < frameSize)
+			regionSize *= 2;
+
+		int waits = ring.waits;
+		ringDestroy(ring);
+		bool created = createStorage(ring, regionSize);
+		ring.waits = waits;
+		if (!created)
+		{
+			std::cerr << "ring: cannot grow to " << RingFrames << " x " << regionSize / 1024 << " KB" << std::endl;
+			return false;
+		}
+	}
+
+	ring.region = (ring.region + 1) % RingFrames;
+	ring.head = 0;
+
+	GLsync &fence = ring.fences[ring.region];
+	if (fence)
+	{
+		// already signaled unless the GPU is RingFrames frames behind
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			ring.waits++;
+			glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	if (ring.persistent)
+	{
+		// NULL still, if creating the storage failed
+		ring.regionMapped = ring.mapped ? ring.mapped + ring.region * ring.regionSize : NULL;
+	}
+	else
+	{
+		// the fence already guarantees the GPU is done with this region
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		stateBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+		ring.regionMapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, ring.region * ring.regionSize,
+															  ring.regionSize, flags);
+	}
+	return ring.regionMapped != NULL;
+}
+
+void *ringAlloc(RingBuffer &ring, GLsizeiptr size, GLsizeiptr align, GLintptr &offset)
+{
+	GLsizeiptr head = (ring.head + align - 1) / align * align;
+	if (ring.regionMapped == NULL || head + size > ring.regionSize)
+		return NULL;
+
+	ring.head = head + size;
+	offset = ring.region * ring.regionSize + head;
+	return ring.regionMapped + head;
+}
+
+void ringFlush(RingBuffer &ring)
+{
+	if (ring.persistent || ring.regionMapped == NULL)
+		return;
+
+	stateBindBuffer(GL_COPY_WRITE_BUFFER, ring.buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	ring.regionMapped = NULL;
+}
+
+void ringEndFrame(RingBuffer &ring)
+{
+	ring.fences[ring.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+//----------------------------------------------------------------------------
+
+static const GLsizeiptr TexelSize = 4 * sizeof(GLfloat);
+
+static GLint maxTexels = 0;
+static GLint rangeAlign = 0; // 0 without glTexBufferRange
+
+void ringTextureInit(RingTexture &view)
+{
+	if (maxTexels == 0)
+	{
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		if (GLVersion() >= 43 || HasGLExtension("GL_ARB_texture_buffer_range"))
+			glGetIntegerv(GL_TEXTURE_BUFFER_OFFSET_ALIGNMENT, &rangeAlign);
+	}
+
+	glGenTextures(1, &view.texture);
+	view.generation = 0;
+	view.offset = 0;
+	view.size = 0;
+}
+
+int ringTextureBind(RingTexture &view, GLuint unit, const RingBuffer &ring, GLintptr offset, GLsizeiptr size)
+{
+	GLintptr start = 0;
+	GLsizeiptr viewSize = ring.regionSize * RingFrames;
+	if (rangeAlign > 0)
+	{
+		start = offset / rangeAlign * rangeAlign;
+		viewSize = offset + size - start;
+	}
+	if (viewSize / TexelSize > maxTexels)
+		return -1;
+
+	stateBindTexture(unit, GL_TEXTURE_BUFFER, view.texture);
+
+	// the ring replaces its buffer when it grows, and may get the old name
+	if (view.generation != ring.generation || view.offset != start || view.size != viewSize)
+	{
+		if (rangeAlign > 0)
+			glTexBufferRange(GL_TEXTURE_BUFFER, GL_RGBA32F, ring.buffer, start, viewSize);
+		else
+			glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, ring.buffer);
+		view.generation = ring.generation;
+		view.offset = start;
+		view.size = viewSize;
+	}
+	return (int)((offset - start) / TexelSize);
+}
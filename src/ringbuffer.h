@@ -0,0 +1,88 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _RINGBUFFER_H_
+#define _RINGBUFFER_H_
+
+#include "cube.h"
+
+//----------------------------------------------------------------------------
+//
+//  --- Per-frame dynamic data ring ---
+//
+//   One buffer object split into RingFrames equal regions.  Each frame writes
+//     its matrices into the next region and puts a fence behind the draws
+//     that read them; by the time the ring comes back around to a region its
+//     fence has normally long signaled, so the CPU never waits on the GPU.
+//
+//   With GL 4.4 or ARB_buffer_storage the buffer is mapped once, persistently
+//     and coherently, and written in place.  Otherwise each region is mapped
+//     unsynchronized for the frame and unmapped by ringFlush(); the fences
+//     make that safe.  Either way the driver never copies the data.
+//
+
+const int RingFrames = 3;
+
+struct RingBuffer
+{
+	GLuint buffer;
+	GLsizeiptr regionSize;
+	bool persistent;
+
+	int region;		 // region being written this frame
+	GLsizeiptr head; // bytes already handed out in it
+	unsigned char *mapped;		 // whole buffer while persistently mapped
+	unsigned char *regionMapped; // start of this frame's region
+	GLsync fences[RingFrames];
+
+	int waits;		// frames that had to block on a fence
+	int generation; // bumped whenever the buffer is replaced, as its name
+					//   may come back for the new one
+};
+
+// Use the unsynchronized-map fallback even where buffer storage exists
+extern bool ringForceFallback;
+
+bool ringInit(RingBuffer &ring, GLsizeiptr regionSize);
+void ringDestroy(RingBuffer &ring);
+
+// Move to the next region, growing the ring first if a frame needs more than
+//   regionSize bytes; false if the region could not be mapped, e.g. when
+//   growing ran out of memory, and every ringAlloc of the frame fails
+bool ringBeginFrame(RingBuffer &ring, GLsizeiptr frameSize);
+
+// Hand out size bytes aligned to align; offset is relative to the buffer.
+//   NULL if they do not fit or the frame has no mapping: skip its draws.
+void *ringAlloc(RingBuffer &ring, GLsizeiptr size, GLsizeiptr align, GLintptr &offset);
+
+// Make this frame's writes visible to GL; call before the draws that use them
+void ringFlush(RingBuffer &ring);
+
+// Fence the region behind this frame's draws
+void ringEndFrame(RingBuffer &ring);
+
+//----------------------------------------------------------------------------
+//
+//   Shaders read ring data through a texture buffer of RGBA32F texels.  With
+//     GL 4.3 or ARB_texture_buffer_range the texture views just the bytes a
+//     draw needs; otherwise it views the whole ring.  Either way the view
+//     must fit in GL_MAX_TEXTURE_BUFFER_SIZE texels, which GL 3.3 only
+//     guarantees to be 65536.
+//
+
+struct RingTexture
+{
+	GLuint texture;
+	int generation;	   // of the ring buffer the texture views, 0 for none
+	GLintptr offset;   // bytes viewed
+	GLsizeiptr size;
+};
+
+void ringTextureInit(RingTexture &view);
+
+// Bind view to a texture unit, showing the size bytes at offset in ring;
+//   returns the texel they start at, or -1 if the view would be too big
+int ringTextureBind(RingTexture &view, GLuint unit, const RingBuffer &ring, GLintptr offset, GLsizeiptr size);
+
+#endif // _RINGBUFFER_H_
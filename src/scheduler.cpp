@@ -0,0 +1,222 @@
+//
+// Fixed-timestep simulation with interpolated, paced rendering
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <mmsystem.h>
+#  pragma comment(lib, "winmm.lib")
+#else
+#  include <sys/resource.h>
+#endif
+
+#include "cube.h"
+#include "scheduler.h"
+
+#if defined(__APPLE__)
+#  include <OpenGL/OpenGL.h>
+#elif defined(__linux__)
+#  include <GL/glx.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+PaceMode paceMode = PACE_FIXED;
+double paceHz = 60.0;
+
+static const Clock::duration simTick =
+	std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(SimTickMs));
+
+static Clock::time_point simClock;	// real time of the last tick
+static double simTime, prevSimTime; // walk clock at the last two ticks, ms
+static Clock::time_point nextFrame;
+
+// pacing of the current mode
+static Clock::time_point modeStart, lastFrame;
+static double modeCpuStart;
+static std::vector<double> intervals;
+
+//----------------------------------------------------------------------------
+
+const char *paceModeName(PaceMode mode)
+{
+	static const char *names[NumPaceModes] = {"uncapped", "vsync", "fixed"};
+	return mode >= 0 && mode < NumPaceModes ? names[mode] : "unknown";
+}
+
+// User plus system CPU time of the whole process
+static double cpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) * 1.0e-7;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1.0e-6;
+#endif
+}
+
+static double milliseconds(Clock::duration d)
+{
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// False where there is no window context or no swap control extension
+static bool setSwapInterval(int interval)
+{
+#if defined(_WIN32)
+	typedef BOOL(WINAPI * SwapIntervalProc)(int);
+	SwapIntervalProc swapInterval = (SwapIntervalProc)wglGetProcAddress("wglSwapIntervalEXT");
+	return wglGetCurrentContext() && swapInterval && swapInterval(interval);
+#elif defined(__APPLE__)
+	GLint value = interval;
+	return CGLGetCurrentContext() && CGLSetParameter(CGLGetCurrentContext(), kCGLCPSwapInterval, &value) == kCGLNoError;
+#elif defined(__linux__)
+	typedef int (*SwapIntervalProc)(unsigned int);
+	if (glXGetCurrentContext() == NULL)
+		return false;
+	// the SGI variant cannot turn swap control off, only on
+	SwapIntervalProc swapInterval = (SwapIntervalProc)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalMESA");
+	if (swapInterval == NULL && interval > 0)
+		swapInterval = (SwapIntervalProc)glXGetProcAddressARB((const GLubyte *)"glXSwapIntervalSGI");
+	return swapInterval && swapInterval(interval) == 0;
+#else
+	(void)interval;
+	return false;
+#endif
+}
+
+static void applyMode()
+{
+	if (!setSwapInterval(paceMode == PACE_VSYNC ? 1 : 0) && paceMode == PACE_VSYNC)
+	{
+		std::cerr << "scheduler: cannot set the swap interval, pacing at " << paceHz << " Hz instead" << std::endl;
+		paceMode = PACE_FIXED;
+	}
+
+	modeStart = lastFrame = nextFrame = Clock::now();
+	modeCpuStart = cpuSeconds();
+	intervals.clear();
+}
+
+//----------------------------------------------------------------------------
+
+void schedulerInit()
+{
+#ifdef _WIN32
+	// 1 ms sleep granularity instead of the default 15.6 ms
+	timeBeginPeriod(1);
+#endif
+
+	simClock = Clock::now();
+	simTime = prevSimTime = 0.0;
+	applyMode();
+}
+
+void schedulerSetMode(PaceMode mode)
+{
+	schedulerReport(std::cout);
+	paceMode = mode;
+	applyMode();
+}
+
+static void sleepUntil(Clock::time_point deadline)
+{
+	std::this_thread::sleep_until(deadline - std::chrono::milliseconds(1));
+	while (Clock::now() < deadline)
+		std::this_thread::yield();
+}
+
+float schedulerNextFrame()
+{
+	if (paceMode == PACE_FIXED)
+	{
+		Clock::duration period =
+			std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / paceHz));
+
+		// more than a frame behind: start over from now rather than rush
+		//   out the missed frames
+		nextFrame += period;
+		if (nextFrame + period < Clock::now())
+			nextFrame = Clock::now();
+		sleepUntil(nextFrame);
+	}
+
+	Clock::time_point now = Clock::now();
+	intervals.push_back(milliseconds(now - lastFrame));
+	lastFrame = now;
+
+	// after a long stall (a debugger, a dragged window) drop the backlog
+	//   instead of fast-forwarding through it
+	if (now - simClock > simTick * 10)
+		simClock = now - simTick;
+
+	while (now - simClock >= simTick)
+	{
+		prevSimTime = simTime;
+		simTime += SimTickMs;
+		simClock += simTick;
+	}
+
+	// render between the last two ticks, one tick behind real time
+	double alpha = milliseconds(now - simClock) / SimTickMs;
+	return (float)(prevSimTime + (simTime - prevSimTime) * alpha);
+}
+
+//----------------------------------------------------------------------------
+
+void schedulerReport(std::ostream &os)
+{
+	double wallSeconds = milliseconds(Clock::now() - modeStart) / 1000.0;
+	double cpu = cpuSeconds() - modeCpuStart;
+
+	// the first interval runs from the mode switch, not from a frame
+	std::vector<double> sorted(intervals.begin() + (intervals.empty() ? 0 : 1), intervals.end());
+	size_t n = sorted.size();
+
+	os << "pace: " << paceModeName(paceMode);
+	if (paceMode == PACE_FIXED)
+		os << " " << paceHz << " Hz";
+
+	if (n == 0 || wallSeconds <= 0.0)
+	{
+		os << ": no frames" << std::endl;
+		return;
+	}
+
+	double sum = 0.0, sumSq = 0.0;
+	for (size_t i = 0; i < n; i++)
+	{
+		sum += sorted[i];
+		sumSq += sorted[i] * sorted[i];
+	}
+	double mean = sum / n;
+	double deviation = sqrt(std::max(sumSq / n - mean * mean, 0.0));
+
+	std::sort(sorted.begin(), sorted.end());
+	double median = sorted[n / 2];
+	double p99 = sorted[(size_t)ceil(0.99 * n) - 1];
+
+	// a frame that took half again as long as usual shows as a hitch
+	int late = 0;
+	for (size_t i = 0; i < n; i++)
+		if (sorted[i] > 1.5 * median)
+			late++;
+
+	os << ": " << n << " frames, " << 1000.0 / mean << " fps, interval " << mean << " +- " << deviation
+	   << " ms (p99 " << p99 << "), " << late << " late, cpu " << 100.0 * cpu / wallSeconds << "% of one core"
+	   << std::endl;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <iostream>
+
+//----------------------------------------------------------------------------
+//
+//  --- Frame scheduler ---
+//
+//   The simulation, which is the walk cycle clock, advances in fixed
+//     SimTickMs steps on std::chrono::steady_clock.  Each frame is rendered
+//     between the last two ticks, interpolated by how far real time has
+//     moved past the last one.  Rendering is not tied to the tick rate, so a
+//     frame rate that does not divide the tick rate still animates smoothly.
+//
+//   How frames are paced:
+//
+//     uncapped  render again as soon as the last frame is done
+//     vsync     swap interval 1; glutSwapBuffers blocks until the display
+//                 refresh, so nothing else waits
+//     fixed     sleep until 1 / paceHz after the previous frame started
+//
+//   Instead of polling the clock all frame long as idle() used to, waits
+//     sleep until a millisecond before the deadline and yield the CPU for
+//     the rest, which absorbs the OS sleep granularity.
+//
+
+enum PaceMode
+{
+	PACE_UNCAPPED,
+	PACE_VSYNC,
+	PACE_FIXED,
+	NumPaceModes
+};
+
+const double SimTickMs = 20.0; // the original idle() step
+
+extern PaceMode paceMode;
+extern double paceHz; // frame rate of PACE_FIXED
+
+const char *paceModeName(PaceMode mode);
+
+// Start the clocks and apply paceMode; the GL context must be current
+void schedulerInit();
+
+// Switch modes, reporting how the previous one did
+void schedulerSetMode(PaceMode mode);
+
+// Wait until the next frame is due, run the simulation ticks that fell due
+//   and return the interpolated animation time in ms
+float schedulerNextFrame();
+
+// Frames, frame rate, interval mean / deviation / p99, late frames and CPU
+//   usage of the current mode so far
+void schedulerReport(std::ostream &os);
+
+#endif // _SCHEDULER_H_
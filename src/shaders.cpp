@@ -0,0 +1,661 @@
+//
+// Program builds off the render thread, and hot reload of changed shaders
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "glstate.h"
+#include "programcache.h"
+#include "reflect.h"
+#include "shaders.h"
+#include "shadersource.h"
+
+#if defined(_WIN32)
+#  include "GL/wglew.h"
+#elif defined(__linux__)
+#  include <sys/inotify.h>
+#  include <unistd.h>
+#  include <GL/glx.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+bool shaderParallelCompile = true;
+
+enum CompileMode
+{
+	COMPILE_INLINE,
+	COMPILE_PARALLEL,
+	COMPILE_WORKER
+};
+
+static const char *compileModeNames[] = {"inline", "parallel", "worker"};
+
+struct ShaderBuild
+{
+	std::string files[2];
+	std::string defines;
+	ShaderSourcePtr sources[2];
+	uint64_t key;
+
+	GLuint program;
+	GLuint shaders[2];
+	bool cached;
+	GLsync sourced;			  // the worker waits for the render thread's setup
+	std::atomic<bool> issued; // compile and link are done on the worker
+
+	double renderMs; // render thread time spent on it
+};
+
+static CompileMode compileMode = COMPILE_INLINE;
+static std::vector<ShaderBuild *> prefetched;
+
+// the worker thread and what it has left to build
+static ShaderWorkerContext worker;
+static std::thread workerThread;
+static std::mutex workerLock;
+static std::condition_variable workerWake, workerDone;
+static std::deque<ShaderBuild *> workerQueue;
+static bool workerQuitting;
+
+// what a program was built from
+struct ProgramFiles
+{
+	std::string files[2];
+	std::string defines;
+	std::vector<std::string> depends; // including the includes
+};
+
+struct WatchedProgram
+{
+	GLuint *program;
+	ProgramFiles files;
+	void (*setup)();
+	bool dirty;
+	ShaderBuild *pending;
+};
+
+static std::map<GLuint, ProgramFiles> programFiles;
+static std::vector<WatchedProgram> watched;
+
+#if defined(__linux__)
+static int notifyFd = -1;
+static std::map<int, std::string> watchedDirs; // inotify watch -> directory
+#else
+static std::map<std::string, time_t> fileTimes;
+static Clock::time_point nextStat;
+#endif
+
+//----------------------------------------------------------------------------
+
+// Print a shader or program info log
+static void printLog(GLuint object, bool program)
+{
+	GLint logSize = 0;
+	if (program)
+		glGetProgramiv(object, GL_INFO_LOG_LENGTH, &logSize);
+	else
+		glGetShaderiv(object, GL_INFO_LOG_LENGTH, &logSize);
+
+	std::vector<char> logMsg(logSize + 1, '\0');
+	if (program)
+		glGetProgramInfoLog(object, logSize, NULL, &logMsg[0]);
+	else
+		glGetShaderInfoLog(object, logSize, NULL, &logMsg[0]);
+	std::cerr << &logMsg[0] << std::endl;
+}
+
+// Active attributes of a linked program and their locations
+static void activeAttribs(GLuint program, std::vector<std::pair<std::string, GLint> > &attribs)
+{
+	GLint count = 0, maxLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+
+	std::vector<char> name(maxLength + 1);
+	for (GLint i = 0; i < count; i++)
+	{
+		GLint size;
+		GLenum type;
+		glGetActiveAttrib(program, i, (GLsizei)name.size(), NULL, &size, &type, &name[0]);
+		if (strncmp(&name[0], "gl_", 3) != 0)
+			attribs.push_back(std::make_pair(std::string(&name[0]), glGetAttribLocation(program, &name[0])));
+	}
+}
+
+//----------------------------------------------------------------------------
+
+// Create the objects and hand GL the source pieces, which it copies, so
+//   the mappings are only read on the render thread.  attribs are the
+//   locations to keep
+static void sourceShaders(ShaderBuild &build, const std::vector<std::pair<std::string, GLint> > &attribs)
+{
+	static const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+
+	build.program = glCreateProgram();
+	for (int i = 0; i < 2; i++)
+	{
+		const ShaderSource &source = *build.sources[i];
+		build.shaders[i] = glCreateShader(types[i]);
+		glShaderSource(build.shaders[i], (GLsizei)source.strings.size(), &source.strings[0], &source.lengths[0]);
+		glAttachShader(build.program, build.shaders[i]);
+	}
+
+	for (size_t i = 0; i < attribs.size(); i++)
+		glBindAttribLocation(build.program, attribs[i].second, attribs[i].first.c_str());
+
+	if (programCacheActive())
+		glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+// Compile and link; may run on the worker.  Status is checked later, so
+//   with parallel compilation none of this waits for the driver
+static void compileAndLink(ShaderBuild &build)
+{
+	for (int i = 0; i < 2; i++)
+		glCompileShader(build.shaders[i]);
+	glLinkProgram(build.program);
+}
+
+static void workerLoop()
+{
+	worker.makeCurrent(worker.context);
+
+	for (;;)
+	{
+		ShaderBuild *build;
+		{
+			std::unique_lock<std::mutex> guard(workerLock);
+			workerWake.wait(guard, [] { return workerQuitting || !workerQueue.empty(); });
+			if (workerQuitting)
+				break;
+			build = workerQueue.front();
+			workerQueue.pop_front();
+		}
+
+		glWaitSync(build->sourced, 0, GL_TIMEOUT_IGNORED);
+		compileAndLink(*build);
+		glFinish(); // the render context may only look once the link is done
+
+		{
+			std::lock_guard<std::mutex> guard(workerLock);
+			build->issued = true;
+		}
+		workerDone.notify_all();
+	}
+
+	worker.makeCurrent(NULL);
+}
+
+// Resolve the files and start the build; previous is the program it
+//   replaces, whose attribute locations it keeps.  NULL if a file cannot be
+//   read
+static ShaderBuild *beginBuild(const char *vertexFile, const char *fragmentFile, const char *defines,
+							   GLuint previous)
+{
+	Clock::time_point start = Clock::now();
+
+	ShaderBuild *build = new ShaderBuild;
+	build->files[0] = vertexFile;
+	build->files[1] = fragmentFile;
+	build->defines = defines ? defines : "";
+	build->shaders[0] = build->shaders[1] = 0;
+	build->sourced = 0;
+	build->issued = false;
+
+	uint64_t sourceKeys[2];
+	for (int i = 0; i < 2; i++)
+	{
+		build->sources[i] = shaderSourceLoad(build->files[i].c_str(), defines);
+		if (!build->sources[i])
+		{
+			delete build;
+			return NULL;
+		}
+		sourceKeys[i] = build->sources[i]->key;
+	}
+
+	std::vector<std::pair<std::string, GLint> > attribs;
+	if (previous)
+		activeAttribs(previous, attribs);
+
+	// a cached binary only stands in if it puts the attributes where the
+	//   VAOs of the program it replaces expect them
+	build->key = programCacheKey(sourceKeys, 2);
+	build->program = glCreateProgram();
+	build->cached = programCacheLoad(build->program, build->key);
+	for (size_t i = 0; i < attribs.size() && build->cached; i++)
+		if (glGetAttribLocation(build->program, attribs[i].first.c_str()) != attribs[i].second)
+			build->cached = false;
+
+	if (build->cached)
+	{
+		build->issued = true;
+	}
+	else
+	{
+		glDeleteProgram(build->program);
+		sourceShaders(*build, attribs);
+
+		if (compileMode == COMPILE_WORKER)
+		{
+			build->sourced = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+			{
+				std::lock_guard<std::mutex> guard(workerLock);
+				workerQueue.push_back(build);
+			}
+			workerWake.notify_one();
+		}
+		else
+		{
+			compileAndLink(*build);
+			build->issued = true;
+		}
+	}
+
+	std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+	build->renderMs = elapsed.count();
+	return build;
+}
+
+// Whether finishBuild() would not block
+static bool buildReady(ShaderBuild *build)
+{
+	if (!build->issued)
+		return false;
+	if (build->cached || compileMode != COMPILE_PARALLEL)
+		return true;
+
+	GLint completed = GL_TRUE;
+	glGetProgramiv(build->program, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
+
+// Check the build and store it in the program cache; the program, or 0
+//   after printing why it failed
+static GLuint finishBuild(ShaderBuild *build)
+{
+	Clock::time_point start = Clock::now();
+
+	if (!build->issued)
+	{
+		std::unique_lock<std::mutex> guard(workerLock);
+		workerDone.wait(guard, [build] { return (bool)build->issued; });
+	}
+
+	if (build->sourced)
+		glDeleteSync(build->sourced);
+
+	GLuint program = build->program;
+	bool built = true;
+
+	if (!build->cached)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			GLint compiled;
+			glGetShaderiv(build->shaders[i], GL_COMPILE_STATUS, &compiled);
+			if (!compiled)
+			{
+				// messages name files by their number in the #line directives
+				const std::vector<std::string> &files = build->sources[i]->files;
+				std::cerr << build->files[i] << " failed to compile:" << std::endl;
+				for (size_t f = 1; f < files.size(); f++)
+					std::cerr << "  " << f << ": " << files[f] << std::endl;
+				printLog(build->shaders[i], false);
+				built = false;
+			}
+			glDeleteShader(build->shaders[i]); // freed with the program
+		}
+
+		GLint linked;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (built && !linked)
+		{
+			std::cerr << "Shader program failed to link" << std::endl;
+			printLog(program, true);
+			built = false;
+		}
+
+		if (built)
+			programCacheStore(program, build->key);
+	}
+
+	if (built)
+	{
+		std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+		programCacheRecord(build->renderMs + elapsed.count(), build->cached);
+		reflectProgram(program);
+		ProgramFiles &files = programFiles[program];
+		files.files[0] = build->files[0];
+		files.files[1] = build->files[1];
+		files.defines = build->defines;
+		for (int i = 0; i < 2; i++)
+			for (size_t f = 0; f < build->sources[i]->files.size(); f++)
+				if (std::find(files.depends.begin(), files.depends.end(), build->sources[i]->files[f]) ==
+					files.depends.end())
+					files.depends.push_back(build->sources[i]->files[f]);
+	}
+	else
+	{
+		glDeleteProgram(program);
+		program = 0;
+	}
+
+	delete build;
+	return program;
+}
+
+static void deleteProgram(GLuint program)
+{
+	reflectForget(program);
+	programFiles.erase(program);
+	glDeleteProgram(program);
+	stateReset();
+}
+
+//----------------------------------------------------------------------------
+
+#ifdef _WIN32
+
+static HDC workerDC;
+
+static bool makeWindowWorkerCurrent(void *context)
+{
+	return wglMakeCurrent(context ? workerDC : NULL, (HGLRC)context) == TRUE;
+}
+
+// A 3.3 core context sharing objects with the window's, on the same window
+static bool windowWorkerContext(ShaderWorkerContext &worker)
+{
+	if (!WGLEW_ARB_create_context)
+		return false;
+
+	const int attribs[] = {
+		WGL_CONTEXT_MAJOR_VERSION_ARB, 3,
+		WGL_CONTEXT_MINOR_VERSION_ARB, 3,
+		WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
+		0};
+	workerDC = wglGetCurrentDC();
+	HGLRC context = wglCreateContextAttribsARB(workerDC, wglGetCurrentContext(), attribs);
+	if (context == NULL)
+		return false;
+
+	worker.context = context;
+	worker.makeCurrent = makeWindowWorkerCurrent;
+	return true;
+}
+
+#endif // _WIN32
+
+// Let the driver use as many compiler threads as it likes
+static void maxCompilerThreads()
+{
+#if defined(__GLEW_H__)
+	if (glMaxShaderCompilerThreadsKHR)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+#elif defined(__linux__)
+	typedef void (*MaxThreadsProc)(GLuint);
+	MaxThreadsProc maxThreads =
+		(MaxThreadsProc)glXGetProcAddressARB((const GLubyte *)"glMaxShaderCompilerThreadsKHR");
+	if (maxThreads)
+		maxThreads(0xFFFFFFFF);
+#endif
+}
+
+void shaderInit(ShaderWorkerFactory workerFactory)
+{
+	shaderShutdown();
+
+	static bool registered = false;
+	if (!registered)
+	{
+		atexit(shaderShutdown);
+		registered = true;
+	}
+
+#ifdef _WIN32
+	if (workerFactory == NULL)
+		workerFactory = windowWorkerContext;
+#endif
+
+	compileMode = COMPILE_INLINE;
+	if (shaderParallelCompile && (HasGLExtension("GL_KHR_parallel_shader_compile") ||
+								  HasGLExtension("GL_ARB_parallel_shader_compile")))
+	{
+		maxCompilerThreads();
+		compileMode = COMPILE_PARALLEL;
+	}
+	else if (workerFactory && workerFactory(worker))
+	{
+		workerQuitting = false;
+		workerThread = std::thread(workerLoop);
+		compileMode = COMPILE_WORKER;
+	}
+
+#if defined(__linux__)
+	notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+
+	std::cout << "shaders: " << compileModeNames[compileMode] << " compilation" << std::endl;
+}
+
+void shaderShutdown()
+{
+	// let the worker finish what it has, so nothing is left half built
+	for (size_t i = 0; i < watched.size(); i++)
+		if (watched[i].pending)
+			deleteProgram(finishBuild(watched[i].pending));
+	watched.clear();
+	for (size_t i = 0; i < prefetched.size(); i++)
+		deleteProgram(finishBuild(prefetched[i]));
+	prefetched.clear();
+	programFiles.clear();
+
+	if (workerThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> guard(workerLock);
+			workerQuitting = true;
+		}
+		workerWake.notify_all();
+		workerThread.join();
+	}
+	workerQueue.clear();
+
+#if defined(__linux__)
+	if (notifyFd >= 0)
+		close(notifyFd);
+	notifyFd = -1;
+	watchedDirs.clear();
+#endif
+}
+
+//----------------------------------------------------------------------------
+
+void shaderPrefetch(const char *vertexFile, const char *fragmentFile, const char *defines)
+{
+	ShaderBuild *build = beginBuild(vertexFile, fragmentFile, defines, 0);
+	if (build)
+		prefetched.push_back(build);
+}
+
+// Create a GLSL program object from vertex and fragment shader files,
+//   picking up the build shaderPrefetch() started if there is one
+GLuint InitShader(const char *vShaderFile, const char *fShaderFile, const char *defines)
+{
+	ShaderBuild *build = NULL;
+	for (size_t i = 0; i < prefetched.size() && build == NULL; i++)
+	{
+		if (prefetched[i]->files[0] == vShaderFile && prefetched[i]->files[1] == fShaderFile &&
+			prefetched[i]->defines == (defines ? defines : ""))
+		{
+			build = prefetched[i];
+			prefetched.erase(prefetched.begin() + i);
+		}
+	}
+	if (build == NULL)
+		build = beginBuild(vShaderFile, fShaderFile, defines, 0);
+
+	GLuint program = build ? finishBuild(build) : 0;
+	if (program == 0)
+		exit(EXIT_FAILURE);
+
+	/* use program object */
+	stateUseProgram(program);
+
+	return program;
+}
+
+//----------------------------------------------------------------------------
+
+static void watchFile(const std::string &path)
+{
+#if defined(__linux__)
+	if (notifyFd < 0)
+		return;
+
+	size_t slash = path.find_last_of('/');
+	std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+	for (std::map<int, std::string>::iterator i = watchedDirs.begin(); i != watchedDirs.end(); ++i)
+		if (i->second == dir)
+			return;
+
+	// editors either rewrite the file or rename a new one over it
+	int wd = inotify_add_watch(notifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd >= 0)
+		watchedDirs[wd] = dir;
+#else
+	struct stat info;
+	if (fileTimes.find(path) == fileTimes.end())
+		fileTimes[path] = stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+#endif
+}
+
+void shaderWatch(GLuint &program, void (*setup)())
+{
+	std::map<GLuint, ProgramFiles>::iterator files = programFiles.find(program);
+	if (files == programFiles.end())
+		return;
+
+	WatchedProgram w;
+	w.program = &program;
+	w.files = files->second;
+	w.setup = setup;
+	w.dirty = false;
+	w.pending = NULL;
+	watched.push_back(w);
+
+	for (size_t i = 0; i < w.files.depends.size(); i++)
+		watchFile(w.files.depends[i]);
+}
+
+static void fileChanged(const std::string &path)
+{
+	shaderSourceChanged(path);
+
+	for (size_t i = 0; i < watched.size(); i++)
+	{
+		const std::vector<std::string> &depends = watched[i].files.depends;
+		if (std::find(depends.begin(), depends.end(), path) != depends.end())
+			watched[i].dirty = true;
+	}
+}
+
+// Mark the programs of every file written since the last call
+static void collectChanges()
+{
+#if defined(__linux__)
+	if (notifyFd < 0)
+		return;
+
+	char buffer[4096];
+	ssize_t length;
+	while ((length = read(notifyFd, buffer, sizeof(buffer))) > 0)
+	{
+		for (char *at = buffer; at < buffer + length;)
+		{
+			const struct inotify_event *event = (const struct inotify_event *)at;
+			if (event->len > 0)
+				fileChanged(watchedDirs[event->wd] + "/" + event->name);
+			at += sizeof(struct inotify_event) + event->len;
+		}
+	}
+#else
+	// no change notification here; a few stat calls twice a second will do
+	Clock::time_point now = Clock::now();
+	if (now < nextStat)
+		return;
+	nextStat = now + std::chrono::milliseconds(500);
+
+	for (std::map<std::string, time_t>::iterator i = fileTimes.begin(); i != fileTimes.end(); ++i)
+	{
+		struct stat info;
+		if (stat(i->first.c_str(), &info) == 0 && info.st_mtime != i->second)
+		{
+			i->second = info.st_mtime;
+			fileChanged(i->first);
+		}
+	}
+#endif
+}
+
+void shaderPoll()
+{
+	if (watched.empty())
+		return;
+
+	collectChanges();
+
+	for (size_t i = 0; i < watched.size(); i++)
+	{
+		WatchedProgram &w = watched[i];
+
+		if (w.pending && buildReady(w.pending))
+		{
+			Clock::time_point start = Clock::now();
+			GLuint program = finishBuild(w.pending);
+			w.pending = NULL;
+
+			if (program)
+			{
+				GLuint previous = *w.program;
+				*w.program = program;
+				w.setup();
+				deleteProgram(previous);
+
+				// an edit may have added or dropped includes
+				w.files = programFiles[program];
+				for (size_t f = 0; f < w.files.depends.size(); f++)
+					watchFile(w.files.depends[f]);
+
+				std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+				std::cout << "shaders: reloaded " << w.files.files[0] << " + " << w.files.files[1] << ", "
+						  << elapsed.count() << " ms on the render thread" << std::endl;
+			}
+		}
+
+		// a file written again while its rebuild runs starts another one
+		if (w.dirty && w.pending == NULL)
+		{
+			w.dirty = false;
+			w.pending = beginBuild(w.files.files[0].c_str(), w.files.files[1].c_str(), w.files.defines.c_str(),
+								   *w.program);
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SHADERS_H_
+#define _SHADERS_H_
+
+#include "cube.h"
+
+//----------------------------------------------------------------------------
+//
+//  --- Asynchronous program builds and hot reload ---
+//
+//   Programs compile in the background where the driver allows it:
+//
+//     parallel  KHR/ARB_parallel_shader_compile; compile and link return at
+//                 once and GL_COMPLETION_STATUS_KHR says when the driver's
+//                 threads are done
+//     worker    a thread of our own with a context sharing objects with the
+//                 render context compiles and links, then glFinish()es
+//     inline    neither: everything happens on the render thread
+//
+//   init() starts every program with shaderPrefetch() before it builds the
+//     meshes, and each module's InitShader() call then only waits for what
+//     is still compiling.
+//
+//   A watched program is rebuilt in the background whenever one of its files,
+//     includes too, is written (inotify on Linux, modification times elsewhere).  The new
+//     program is linked with the attribute locations of the old one so
+//     existing VAOs keep working.  Once it is ready and has linked, it
+//     replaces the old one between frames and the module's setup function
+//     runs to refetch uniform locations.  A shader that fails to compile is
+//     reported and the old program stays.
+//
+
+// Context sharing objects with the render context, for the worker thread
+struct ShaderWorkerContext
+{
+	void *context;
+	bool (*makeCurrent)(void *context); // NULL releases
+};
+
+typedef bool (*ShaderWorkerFactory)(ShaderWorkerContext &worker);
+
+extern bool shaderParallelCompile; // off with -noparallelcompile
+
+// Pick how programs build; workerFactory makes the worker's context where
+//   parallel compilation is missing, NULL for the window's on Windows
+void shaderInit(ShaderWorkerFactory workerFactory);
+void shaderShutdown();
+
+// Start building a program, to be picked up by InitShader() with the same
+//   files and defines
+void shaderPrefetch(const char *vertexFile, const char *fragmentFile, const char *defines = NULL);
+
+// Rebuild program whenever its files change; setup runs on the render
+//   thread right after the new program has replaced the old one
+void shaderWatch(GLuint &program, void (*setup)());
+
+// Swap in finished rebuilds and start those that fell due; call once per
+//   frame on the render thread
+void shaderPoll();
+
+#endif // _SHADERS_H_
@@ -0,0 +1,269 @@
+//
+// Memory-mapped shader files with #include and #define resolution
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+#include "programcache.h"
+#include "shadersource.h"
+
+struct MappedFile
+{
+	const char *data;
+	size_t size;
+
+	MappedFile() : data(NULL), size(0) {}
+	~MappedFile();
+};
+
+static std::map<std::string, std::shared_ptr<const MappedFile> > mappedFiles;
+static std::map<std::string, ShaderSourcePtr> resolved; // by path '\n' defines
+
+//----------------------------------------------------------------------------
+
+MappedFile::~MappedFile()
+{
+	if (data == NULL || size == 0)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+#else
+	munmap((void *)data, size);
+#endif
+}
+
+// Map a whole file read-only; NULL if it cannot be opened
+static std::shared_ptr<const MappedFile> mapFile(const std::string &path)
+{
+	std::map<std::string, std::shared_ptr<const MappedFile> >::iterator cached = mappedFiles.find(path);
+	if (cached != mappedFiles.end())
+		return cached->second;
+
+	std::shared_ptr<MappedFile> file(new MappedFile);
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+								NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+		return std::shared_ptr<const MappedFile>();
+
+	LARGE_INTEGER size;
+	GetFileSizeEx(handle, &size);
+	file->size = (size_t)size.QuadPart;
+	if (file->size > 0)
+	{
+		// the view keeps the mapping, and that the file, open
+		HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping)
+		{
+			file->data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(handle);
+#else
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return std::shared_ptr<const MappedFile>();
+
+	struct stat info;
+	if (fstat(fd, &info) == 0 && info.st_size > 0)
+	{
+		file->size = (size_t)info.st_size;
+		void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		file->data = data == MAP_FAILED ? NULL : (const char *)data;
+	}
+	close(fd); // the mapping stays valid
+#endif
+
+	if (file->size > 0 && file->data == NULL)
+		return std::shared_ptr<const MappedFile>();
+	if (file->data == NULL)
+		file->data = "";
+
+	mappedFiles[path] = file;
+	return file;
+}
+
+//----------------------------------------------------------------------------
+
+// Name of the file in a '#include "name"' line, if it is one
+static bool includeLine(const char *line, const char *end, std::string &name)
+{
+	const char *at = line;
+	while (at < end && (*at == ' ' || *at == '\t'))
+		at++;
+	if (at == end || *at++ != '#')
+		return false;
+	while (at < end && (*at == ' ' || *at == '\t'))
+		at++;
+	if (end - at < 7 || strncmp(at, "include", 7) != 0)
+		return false;
+	at += 7;
+	while (at < end && (*at == ' ' || *at == '\t'))
+		at++;
+	if (at == end || *at++ != '"')
+		return false;
+
+	const char *close = (const char *)memchr(at, '"', end - at);
+	if (close == NULL)
+		return false;
+	name.assign(at, close);
+	return true;
+}
+
+static bool versionLine(const char *line, const char *end)
+{
+	while (line < end && (*line == ' ' || *line == '\t'))
+		line++;
+	return end - line >= 8 && strncmp(line, "#version", 8) == 0;
+}
+
+static void addPiece(ShaderSource &source, const char *text, size_t length)
+{
+	if (length == 0)
+		return;
+	source.strings.push_back(text);
+	source.lengths.push_back((GLint)length);
+}
+
+static void addGenerated(ShaderSource &source, const std::string &text)
+{
+	source.generated.push_back(text);
+	addPiece(source, source.generated.back().c_str(), text.size());
+}
+
+static std::string lineDirective(int line, int file)
+{
+	char text[32];
+	sprintf(text, "#line %d %d\n", line, file);
+	return text;
+}
+
+// "A B=1" as "#define A\n#define B 1\n"
+static std::string defineLines(const char *defines)
+{
+	std::string lines;
+	for (const char *at = defines; at && *at;)
+	{
+		while (*at == ' ')
+			at++;
+		const char *end = at;
+		while (*end && *end != ' ')
+			end++;
+		if (end > at)
+		{
+			std::string define(at, end);
+			size_t equals = define.find('=');
+			if (equals != std::string::npos)
+				define[equals] = ' ';
+			lines += "#define " + define + "\n";
+		}
+		at = end;
+	}
+	return lines;
+}
+
+// Add the pieces of path, recursing into its includes
+static bool appendFile(ShaderSource &source, const std::string &path, const std::string &defines)
+{
+	std::shared_ptr<const MappedFile> file = mapFile(path);
+	if (!file)
+	{
+		std::cerr << "Failed to read " << path << std::endl;
+		return false;
+	}
+
+	int index = (int)source.files.size();
+	source.files.push_back(path);
+	source.mappings.push_back(file);
+
+	size_t slash = path.find_last_of("/\\");
+	std::string dir = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+
+	const char *run = file->data, *end = file->data + file->size;
+	int lineNumber = 1;
+	for (const char *line = file->data; line < end; lineNumber++)
+	{
+		const char *next = (const char *)memchr(line, '\n', end - line);
+		next = next ? next + 1 : end;
+
+		std::string name;
+		if (index == 0 && versionLine(line, next) && !defines.empty())
+		{
+			// defines go straight after #version, which must come first
+			addPiece(source, run, next - run);
+			addGenerated(source, defines);
+			addGenerated(source, lineDirective(lineNumber + 1, index));
+			run = next;
+		}
+		else if (includeLine(line, next, name))
+		{
+			addPiece(source, run, line - run);
+			run = next;
+
+			std::string included = dir + name;
+			bool seen = false;
+			for (size_t i = 0; i < source.files.size(); i++)
+				seen = seen || source.files[i] == included;
+			if (!seen)
+			{
+				addGenerated(source, lineDirective(1, (int)source.files.size()));
+				if (!appendFile(source, included, defines))
+					return false;
+			}
+			addGenerated(source, lineDirective(lineNumber + 1, index));
+		}
+		line = next;
+	}
+	addPiece(source, run, end - run);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+
+ShaderSourcePtr shaderSourceLoad(const char *path, const char *defines)
+{
+	std::string key = std::string(path) + "\n" + (defines ? defines : "");
+	std::map<std::string, ShaderSourcePtr>::iterator cached = resolved.find(key);
+	if (cached != resolved.end())
+		return cached->second;
+
+	std::shared_ptr<ShaderSource> source(new ShaderSource);
+	if (!appendFile(*source, path, defineLines(defines)))
+		return ShaderSourcePtr();
+
+	source->key = ProgramCacheHashSeed;
+	for (size_t i = 0; i < source->strings.size(); i++)
+		source->key = programCacheHash(source->strings[i], source->lengths[i], source->key);
+
+	resolved[key] = source;
+	return source;
+}
+
+void shaderSourceChanged(const std::string &path)
+{
+	mappedFiles.erase(path);
+
+	// builds still holding a source keep its mappings until they finish
+	for (std::map<std::string, ShaderSourcePtr>::iterator i = resolved.begin(); i != resolved.end();)
+	{
+		const std::vector<std::string> &files = i->second->files;
+		if (std::find(files.begin(), files.end(), path) != files.end())
+			resolved.erase(i++);
+		else
+			++i;
+	}
+}
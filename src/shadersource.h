@@ -0,0 +1,58 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SHADERSOURCE_H_
+#define _SHADERSOURCE_H_
+
+#include <deque>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "cube.h"
+
+//----------------------------------------------------------------------------
+//
+//  --- Shader source files ---
+//
+//   Shader files are memory-mapped, never copied.  A source is the list of
+//     string pieces glShaderSource() takes: runs of mapped text, with
+//     '#include "file"' lines replaced by the pieces of that file (relative
+//     to the including one, each file at most once) and the defines placed
+//     right after #version.  Short generated #line directives between the
+//     runs keep compiler messages pointing at the right file and line; the
+//     second number of a #line is the file's index in files.
+//
+//   Files stay mapped and resolved sources are kept per file and define set,
+//     so building many variants of a shader touches the disk once.  A source
+//     is identified by the hash of its text, which is also what the program
+//     cache is keyed on.  shaderSourceChanged() drops what depends on a file
+//     that was rewritten.
+//
+
+struct MappedFile;
+
+struct ShaderSource
+{
+	std::vector<const GLchar *> strings;
+	std::vector<GLint> lengths;
+	std::vector<std::string> files; // the file itself, then its includes
+	uint64_t key;					// hash of all the text
+
+	// keeps the mapped and generated text alive while a build uses it
+	std::vector<std::shared_ptr<const MappedFile> > mappings;
+	std::deque<std::string> generated;
+};
+
+typedef std::shared_ptr<const ShaderSource> ShaderSourcePtr;
+
+// Resolve a file with defines, space separated NAME or NAME=VALUE (may be
+//   NULL); NULL after printing why if a file cannot be read
+ShaderSourcePtr shaderSourceLoad(const char *path, const char *defines);
+
+// Forget path and everything resolved from it
+void shaderSourceChanged(const std::string &path);
+
+#endif // _SHADERSOURCE_H_
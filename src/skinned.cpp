@@ -0,0 +1,257 @@
+//
+// Smooth elephant mesh deformed by dual-quaternion blending
+//
+
+#define GLM_ENABLE_EXPERIMENTAL
+
+#include <cstddef>
+#include <vector>
+
+#include "camera.h"
+#include "cubemesh.h"
+#include "glstate.h"
+#include "herd.h"
+#include "merged.h"
+#include "reflect.h"
+#include "rig.h"
+#include "shaders.h"
+#include "skinned.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtx/dual_quaternion.hpp"
+#include "glm/packing.hpp"
+
+struct SkinnedVertex
+{
+	glm::vec4 position; // rest pose, elephant space
+	GLuint color;		// unorm 8:8:8:8
+	GLushort bones[2];
+	GLfloat weight; // of bones[1]
+};
+
+// a dual quaternion as the shader reads it, x y z w each
+struct BoneDualQuat
+{
+	glm::vec4 real;
+	glm::vec4 dual;
+};
+
+static const int faceSteps = 4;		  // grid cells along each box edge
+static const float roundness = 0.5f;  // 0 box, 1 ellipsoid
+static const float jointBlend = 0.5f; // blend reach from the joint, in part sizes
+
+static int boneCount;
+static int boneParts[NumRigParts];
+static glm::mat4 inverseRest[NumRigParts]; // per bone
+
+static BonePaletteMesh skinnedMesh;
+static GLuint skinnedBuffers[2]; // vertices, indices
+static UniformHandle<glm::mat4> worldMatrix;
+
+//----------------------------------------------------------------------------
+
+// Subdivided unit box with its corners pulled toward the inscribed sphere,
+//   colored like the cube by blending the corner colors
+static void roundedBox(std::vector<glm::vec3> &positions, std::vector<glm::vec4> &colors,
+					   std::vector<GLushort> &indices)
+{
+	glm::vec4 corners[8], cornerColors[8];
+	GLushort triangles[36];
+	cubeMeshCorners(corners, cornerColors, triangles);
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int side = -1; side <= 1; side += 2)
+		{
+			int u = (axis + 1) % 3, v = (axis + 2) % 3;
+			GLushort base = (GLushort)positions.size();
+
+			for (int i = 0; i <= faceSteps; i++)
+			{
+				for (int j = 0; j <= faceSteps; j++)
+				{
+					glm::vec3 p;
+					p[axis] = 0.5f * side;
+					p[u] = -0.5f + (float)i / faceSteps;
+					p[v] = -0.5f + (float)j / faceSteps;
+
+					// trilinear blend of the corner colors
+					glm::vec4 color(0.0f);
+					for (int c = 0; c < 8; c++)
+					{
+						glm::vec3 w = glm::vec3(0.5f) + glm::sign(glm::vec3(corners[c])) * p;
+						color += w.x * w.y * w.z * cornerColors[c];
+					}
+
+					positions.push_back(glm::mix(p, glm::normalize(p) * 0.5f, roundness));
+					colors.push_back(color);
+				}
+			}
+
+			for (int i = 0; i < faceSteps; i++)
+			{
+				for (int j = 0; j < faceSteps; j++)
+				{
+					GLushort a = base + i * (faceSteps + 1) + j, b = a + faceSteps + 1;
+					GLushort quad[6] = {a, b, (GLushort)(b + 1), a, (GLushort)(b + 1), (GLushort)(a + 1)};
+					indices.insert(indices.end(), quad, quad + 6);
+				}
+			}
+		}
+	}
+}
+
+// Uniforms and bindings of the skinned program, again after every reload
+static void setupSkinnedProgram()
+{
+	GLuint program = skinnedMesh.program;
+	stateUseProgram(program);
+	reflectSet(program, "bonePalette", 0);
+	reflectSet(program, "boneCount", boneCount);
+	skinnedMesh.paletteBase = reflectUniform<int>(program, "paletteBase");
+	worldMatrix = reflectUniform<glm::mat4>(program, "mWorld");
+	cameraBindProgram(program);
+}
+
+void skinnedInit()
+{
+	RigPose rest;
+	rest.valid = false;
+	rigEvaluate(rest, 0.0f);
+
+	int boneOf[NumRigParts];
+	boneCount = rigBones(boneParts, boneOf);
+	for (int b = 0; b < boneCount; b++)
+		inverseRest[b] = glm::inverse(rest.world[boneParts[b]]);
+
+	std::vector<glm::vec3> boxPositions;
+	std::vector<glm::vec4> boxColors;
+	std::vector<GLushort> boxIndices;
+	roundedBox(boxPositions, boxColors, boxIndices);
+
+	std::vector<SkinnedVertex> vertices;
+	std::vector<GLushort> indices;
+
+	for (int i = 0; i < NumRigParts; i++)
+	{
+		const RigPart &part = rigParts[i];
+		if (part.scale == glm::vec3(0.0f))
+			continue;
+
+		int bone = boneOf[i];
+		glm::mat4 boneToBox(1.0f);
+		for (int j = i; j != boneParts[bone]; j = rigParts[j].parent)
+			boneToBox = rest.local[j] * boneToBox;
+		boneToBox = glm::scale(boneToBox, part.scale);
+
+		// an animated part bends toward its parent's bone around the
+		//   pivot it turns about
+		int parentBone = part.parent >= 0 ? boneOf[part.parent] : bone;
+		bool bends = boneParts[bone] == i && parentBone != bone;
+
+		float nearest = 1.0e9f;
+		for (size_t k = 0; k < boxPositions.size(); k++)
+			nearest = glm::min(nearest, glm::distance(glm::vec3(boneToBox * glm::vec4(boxPositions[k], 1.0f)), part.pivot));
+		float reach = jointBlend * glm::length(part.scale);
+
+		GLushort base = (GLushort)vertices.size();
+		for (size_t k = 0; k < boxPositions.size(); k++)
+		{
+			glm::vec4 boneSpace = boneToBox * glm::vec4(boxPositions[k], 1.0f);
+
+			SkinnedVertex v;
+			v.position = rest.world[boneParts[bone]] * boneSpace;
+			v.color = glm::packUnorm4x8(boxColors[k]);
+			v.bones[0] = (GLushort)bone;
+			v.bones[1] = (GLushort)parentBone;
+			v.weight = 0.0f;
+			if (bends)
+			{
+				float d = glm::distance(glm::vec3(boneSpace), part.pivot) - nearest;
+				v.weight = 0.5f * glm::clamp(1.0f - d / reach, 0.0f, 1.0f);
+			}
+			vertices.push_back(v);
+		}
+		for (size_t k = 0; k < boxIndices.size(); k++)
+			indices.push_back(base + boxIndices[k]);
+	}
+	skinnedMesh.indexCount = (GLsizei)indices.size();
+
+	std::cout << "skinned: " << vertices.size() << " vertices, " << indices.size() / 3 << " triangles on "
+			  << boneCount << " bones, " << sizeof(BoneDualQuat) << " bytes per bone" << std::endl;
+
+	skinnedMesh.program = InitShader("src/vshader_skinned.glsl", "src/fshader.glsl");
+	setupSkinnedProgram();
+	shaderWatch(skinnedMesh.program, setupSkinnedProgram);
+
+	glGenVertexArrays(1, &skinnedMesh.vao);
+	stateBindVertexArray(skinnedMesh.vao);
+
+	glGenBuffers(2, skinnedBuffers);
+	stateBindBuffer(GL_ARRAY_BUFFER, skinnedBuffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SkinnedVertex), &vertices[0], GL_STATIC_DRAW);
+	stateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skinnedBuffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+	// the linker may drop any of them from an edited shader
+	GLint vPosition = reflectAttrib(skinnedMesh.program, "vPosition", GL_FLOAT_VEC4);
+	if (vPosition >= 0)
+	{
+		glEnableVertexAttribArray(vPosition);
+		glVertexAttribPointer(vPosition, 4, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex),
+							  BUFFER_OFFSET(offsetof(SkinnedVertex, position)));
+	}
+
+	GLint vColor = reflectAttrib(skinnedMesh.program, "vColor", GL_FLOAT_VEC4);
+	if (vColor >= 0)
+	{
+		glEnableVertexAttribArray(vColor);
+		glVertexAttribPointer(vColor, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinnedVertex),
+							  BUFFER_OFFSET(offsetof(SkinnedVertex, color)));
+	}
+
+	GLint vBones = reflectAttrib(skinnedMesh.program, "vBones", GL_UNSIGNED_INT_VEC2);
+	if (vBones >= 0)
+	{
+		glEnableVertexAttribArray(vBones);
+		glVertexAttribIPointer(vBones, 2, GL_UNSIGNED_SHORT, sizeof(SkinnedVertex),
+							   BUFFER_OFFSET(offsetof(SkinnedVertex, bones)));
+	}
+
+	GLint vWeight = reflectAttrib(skinnedMesh.program, "vWeight", GL_FLOAT);
+	if (vWeight >= 0)
+	{
+		glEnableVertexAttribArray(vWeight);
+		glVertexAttribPointer(vWeight, 1, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex),
+							  BUFFER_OFFSET(offsetof(SkinnedVertex, weight)));
+	}
+
+	// one instance per elephant, posed as a whole
+	herdInstanceAttribs(skinnedMesh.program, 1);
+
+	stateBindVertexArray(0);
+
+	ringTextureInit(skinnedMesh.texture);
+}
+
+//----------------------------------------------------------------------------
+
+bool skinnedDraw(RingBuffer &ring, const glm::mat4 &worldMat, float timeMs)
+{
+	herdUpdateInstances();
+
+	stateUseProgram(skinnedMesh.program);
+	uniformSet(worldMatrix, worldMat);
+
+	// motion of every bone from the rest pose, a dual quaternion per bone
+	int texels = boneCount * (int)(sizeof(BoneDualQuat) / sizeof(glm::vec4));
+	return bonePaletteDraw(ring, skinnedMesh, texels, timeMs, [](int, const RigPose &pose, void *out) {
+		BoneDualQuat *palette = (BoneDualQuat *)out;
+		for (int b = 0; b < boneCount; b++)
+		{
+			glm::mat4 motion = pose.world[boneParts[b]] * inverseRest[b];
+			glm::dualquat dq = glm::dualquat_cast(glm::mat3x4(glm::transpose(motion)));
+			palette[b].real = glm::vec4(dq.real.x, dq.real.y, dq.real.z, dq.real.w);
+			palette[b].dual = glm::vec4(dq.dual.x, dq.dual.y, dq.dual.z, dq.dual.w);
+		}
+	});
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SKINNED_H_
+#define _SKINNED_H_
+
+#include "cube.h"
+#include "ringbuffer.h"
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Dual-quaternion skinned elephant ---
+//
+//   A smooth elephant: every part becomes a subdivided, rounded box with
+//     colors blended across it from the cube corners, and the mesh is
+//     stored once in its rest pose.  Vertices of an animated part near the
+//     joint it turns about are weighted between its bone and the parent's,
+//     so hips, knees, ankles and the trunk bend instead of hinging.
+//
+//   The bones are those of the merged mesh.  Each frame uploads, per
+//     elephant and bone, the rigid motion from the rest pose as a dual
+//     quaternion of 8 floats, half of a matrix, and the vertex shader blends
+//     the two bones of a vertex without the volume loss of blended matrices.
+//     Placement, which may scale, is applied after skinning.  The herd is
+//     still a single instanced draw.
+//
+
+// Build the mesh and program
+void skinnedInit();
+
+// Pose the herd into the ring and draw it; false, drawing nothing, if the
+//   palettes are too big for a texture buffer
+bool skinnedDraw(RingBuffer &ring, const glm::mat4 &worldMat, float timeMs);
+
+#endif // _SKINNED_H_
@@ -0,0 +1,106 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _STD140_H_
+#define _STD140_H_
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include "glm/glm.hpp"
+
+//----------------------------------------------------------------------------
+//
+//  --- Compile-time std140 layout checks ---
+//
+//   A uniform block is uploaded straight from a C++ struct, so the struct has
+//     to have exactly the std140 layout of the block.  Std140Layout<...> lists
+//     the GLSL member types in declaration order and computes the std140
+//     offset of each; the STD140_* macros compare those against offsetof and
+//     sizeof of the struct and fail the build on any mismatch.
+//
+//   Only types whose C++ size equals their std140 size can be members.  A
+//     type with no Std140 specialization (glm::mat3, bool, float[4], ...)
+//     does not compile.
+//
+
+// Base alignment and size of one block member
+template <typename T>
+struct Std140;
+
+#define STD140_TYPE(T, alignment, bytes)                  \
+	template <>                                           \
+	struct Std140<T>                                      \
+	{                                                     \
+		static constexpr size_t align = alignment;        \
+		static constexpr size_t size = bytes;             \
+		static_assert(sizeof(T) == bytes, #T " size");    \
+	}
+
+STD140_TYPE(float, 4, 4);
+STD140_TYPE(int, 4, 4);
+STD140_TYPE(unsigned int, 4, 4);
+STD140_TYPE(glm::vec2, 8, 8);
+STD140_TYPE(glm::vec3, 16, 12);
+STD140_TYPE(glm::vec4, 16, 16);
+STD140_TYPE(glm::ivec4, 16, 16);
+STD140_TYPE(glm::uvec4, 16, 16);
+STD140_TYPE(glm::mat4, 16, 64);
+
+#undef STD140_TYPE
+
+// Arrays are strided to a multiple of 16 bytes, which only matches C++ for
+//   16-byte element types
+template <typename T, size_t N>
+struct Std140<T[N]>
+{
+	static_assert(Std140<T>::size % 16 == 0, "std140 array elements are padded to 16 bytes");
+	static constexpr size_t align = 16;
+	static constexpr size_t size = Std140<T>::size * N;
+};
+
+template <typename... Members>
+struct Std140Layout
+{
+	template <size_t Index>
+	using type = typename std::tuple_element<Index, std::tuple<Members...>>::type;
+
+	// Offset of member index, placed after the ones before it
+	static constexpr size_t offset(size_t index)
+	{
+		const size_t aligns[] = {Std140<Members>::align...};
+		const size_t sizes[] = {Std140<Members>::size...};
+
+		size_t at = 0;
+		for (size_t i = 0;; i++)
+		{
+			at = (at + aligns[i] - 1) / aligns[i] * aligns[i];
+			if (i == index)
+				return at;
+			at += sizes[i];
+		}
+	}
+
+	// Size of the whole block, rounded up to a vec4
+	static constexpr size_t size()
+	{
+		const size_t sizes[] = {Std140<Members>::size...};
+		size_t last = sizeof...(Members) - 1;
+		return (offset(last) + sizes[last] + 15) / 16 * 16;
+	}
+};
+
+// Member index of Block must have the layout's type and std140 offset
+#define STD140_MEMBER(Block, Layout, index, member)                                                  \
+	static_assert(std::is_same<decltype(Block::member), Layout::type<index>>::value,              \
+				  #Block "::" #member " has the wrong type for its block member");                  \
+	static_assert(offsetof(Block, member) == Layout::offset(index),                                 \
+				  #Block "::" #member " is not at its std140 offset")
+
+// Block must have no trailing members or padding beyond the layout
+#define STD140_SIZE(Block, Layout) \
+	static_assert(sizeof(Block) == Layout::size(), #Block " is not the std140 size of its block")
+
+#endif // _STD140_H_
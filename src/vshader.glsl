@@ -4,10 +4,15 @@ in  vec4 vPosition;
 in  vec4 vColor;
 out vec4 color;
 
-uniform mat4 mPVM;
+#include "cubevertex.glsl"
+
+#include "camera.glsl"
+
+uniform mat4 mModel;
 
 void main() 
 {
-  gl_Position = mPVM * vPosition;
-  color = vColor;
+  vec4 position;
+  cubeVertex(position, color);
+  gl_Position = mViewProj * mModel * position;
 } 
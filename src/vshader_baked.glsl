@@ -0,0 +1,44 @@
+#version 150
+
+in  vec4 vPosition;
+in  vec4 vColor;
+in  mat4 mRoot;        // placement of the elephant, one per NumRigModels instances
+in  float phaseOffset; // its walk cycle offset in ms
+out vec4 color;
+
+#include "cubevertex.glsl"
+
+#include "camera.glsl"
+
+uniform mat4 mWorld;
+
+// bakePhases poses of partCount model matrices, 4 texels each
+uniform samplerBuffer bakedPoses;
+uniform int bakePhases;
+uniform int partCount;
+
+uniform float cycleTime;   // animation time modulo cyclePeriod, ms
+uniform float cyclePeriod;
+
+mat4 bakedModel(int phase, int part)
+{
+  int texel = (phase * partCount + part) * 4;
+  return mat4(texelFetch(bakedPoses, texel), texelFetch(bakedPoses, texel + 1),
+              texelFetch(bakedPoses, texel + 2), texelFetch(bakedPoses, texel + 3));
+}
+
+void main()
+{
+  int part = gl_InstanceID % partCount;
+
+  // blend the two baked poses either side of this elephant's cycle time
+  float t = mod(cycleTime + phaseOffset, cyclePeriod) / cyclePeriod * float(bakePhases);
+  int phase = min(int(t), bakePhases - 1);
+  mat4 before = bakedModel(phase, part);
+  mat4 after = bakedModel((phase + 1) % bakePhases, part);
+  mat4 model = before + (after - before) * fract(t);
+
+  vec4 position;
+  cubeVertex(position, color);
+  gl_Position = mViewProj * mWorld * mRoot * model * position;
+}
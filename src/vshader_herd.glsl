@@ -0,0 +1,37 @@
+#version 150
+
+// MODEL_FROM_DRAW_ID: one multi-draw for every part, each draw fetching its
+//   matrix by gl_DrawIDARB instead of an instanced attribute
+#ifdef MODEL_FROM_DRAW_ID
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+
+in  vec4 vPosition;
+in  vec4 vColor;
+#ifndef MODEL_FROM_DRAW_ID
+in  mat4 mModel;
+#endif
+out vec4 color;
+
+#include "cubevertex.glsl"
+
+#include "camera.glsl"
+
+#ifdef MODEL_FROM_DRAW_ID
+// one matrix per draw, 4 texels each, from texel modelBase
+uniform samplerBuffer models;
+uniform int modelBase;
+#endif
+
+void main()
+{
+#ifdef MODEL_FROM_DRAW_ID
+  int texel = modelBase + gl_DrawIDARB * 4;
+  mat4 mModel = mat4(texelFetch(models, texel), texelFetch(models, texel + 1),
+                     texelFetch(models, texel + 2), texelFetch(models, texel + 3));
+#endif
+
+  vec4 position;
+  cubeVertex(position, color);
+  gl_Position = mViewProj * mModel * position;
+}
@@ -0,0 +1,23 @@
+#version 150
+
+in  vec4 vPosition; // in the space of its bone
+in  vec4 vColor;
+in  uint vBone;
+out vec4 color;
+
+#include "camera.glsl"
+
+// boneCount matrices per elephant, 4 texels each, from texel paletteBase
+uniform samplerBuffer bonePalette;
+uniform int paletteBase;
+uniform int boneCount;
+
+void main()
+{
+  int texel = paletteBase + (gl_InstanceID * boneCount + int(vBone)) * 4;
+  mat4 bone = mat4(texelFetch(bonePalette, texel), texelFetch(bonePalette, texel + 1),
+                   texelFetch(bonePalette, texel + 2), texelFetch(bonePalette, texel + 3));
+
+  gl_Position = mViewProj * bone * vPosition;
+  color = vColor;
+}
@@ -0,0 +1,76 @@
+#version 150
+
+in  vec4 vPosition;
+in  vec4 vColor;
+in  mat4 mRoot;        // placement of the elephant, one per NumRigModels instances
+in  float phaseOffset; // its walk cycle offset in ms
+out vec4 color;
+
+#include "cubevertex.glsl"
+
+#include "camera.glsl"
+
+// The rig table of rig.cpp, one entry per part
+layout(std140) uniform Rig
+{
+  vec4  rigOffset[27];  // xyz offset from the parent joint, w parent index or -1
+  vec4  rigRest[27];    // xyz rest rotation axis, w angle
+  vec4  rigPivot[27];   // xyz pivot of the animated rotation
+  vec4  rigAnim[27];    // xyz animated rotation axis, w gain
+  vec4  rigScale[27];   // xyz box scale
+  ivec4 rigDrawn[26];   // x: part drawn by each model slot
+};
+
+uniform mat4 mWorld;
+uniform int partCount;    // drawn parts per elephant
+
+uniform float cycleTime;  // animation time modulo cyclePeriod, ms
+uniform float cyclePeriod;
+
+// glm::rotate
+mat4 rotation(float angle, vec3 axis)
+{
+  vec3 a = normalize(axis);
+  float c = cos(angle), s = sin(angle);
+  vec3 t = (1.0 - c) * a;
+  return mat4(vec4(c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y, 0.0),
+              vec4(t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x, 0.0),
+              vec4(t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z, 0.0),
+              vec4(0.0, 0.0, 0.0, 1.0));
+}
+
+mat4 translation(vec3 v)
+{
+  return mat4(vec4(1.0, 0.0, 0.0, 0.0), vec4(0.0, 1.0, 0.0, 0.0), vec4(0.0, 0.0, 1.0, 0.0), vec4(v, 1.0));
+}
+
+// translate(offset) * rotate(rest) * translate(pivot) * rotate(gain * angle) * translate(-pivot)
+mat4 localTransform(int part, float angle)
+{
+  mat4 m = translation(rigOffset[part].xyz);
+  if (rigRest[part].w != 0.0)
+    m = m * rotation(rigRest[part].w, rigRest[part].xyz);
+  if (rigAnim[part].w != 0.0)
+    m = m * translation(rigPivot[part].xyz) * rotation(rigAnim[part].w * angle, rigAnim[part].xyz)
+          * translation(-rigPivot[part].xyz);
+  return m;
+}
+
+void main()
+{
+  int part = rigDrawn[gl_InstanceID % partCount].x;
+
+  // rigWalkCycle()
+  float t = mod(cycleTime + phaseOffset, cyclePeriod);
+  float angle = radians(cos(t / 100.0) * 360.0 / 2000.0);
+
+  // climb from the part to the root, prepending each joint
+  mat4 model = mat4(vec4(rigScale[part].x, 0.0, 0.0, 0.0), vec4(0.0, rigScale[part].y, 0.0, 0.0),
+                    vec4(0.0, 0.0, rigScale[part].z, 0.0), vec4(0.0, 0.0, 0.0, 1.0));
+  for (int joint = part; joint >= 0; joint = int(rigOffset[joint].w))
+    model = localTransform(joint, angle) * model;
+
+  vec4 position;
+  cubeVertex(position, color);
+  gl_Position = mViewProj * mWorld * mRoot * model * position;
+}
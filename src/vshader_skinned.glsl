@@ -0,0 +1,51 @@
+#version 150
+
+in  vec4 vPosition; // rest pose
+in  vec4 vColor;
+in  uvec2 vBones;
+in  float vWeight;     // of vBones.y
+in  mat4 mRoot;        // placement of the elephant, one per instance
+out vec4 color;
+
+#include "camera.glsl"
+
+uniform mat4 mWorld;
+
+// boneCount dual quaternions per elephant, real and dual part in one texel
+//   each, from texel paletteBase
+uniform samplerBuffer bonePalette;
+uniform int paletteBase;
+uniform int boneCount;
+
+void boneDualQuat(uint bone, out vec4 real, out vec4 dual)
+{
+  int texel = paletteBase + (gl_InstanceID * boneCount + int(bone)) * 2;
+  real = texelFetch(bonePalette, texel);
+  dual = texelFetch(bonePalette, texel + 1);
+}
+
+void main()
+{
+  vec4 real0, dual0, real1, dual1;
+  boneDualQuat(vBones.x, real0, dual0);
+  boneDualQuat(vBones.y, real1, dual1);
+
+  // blend along the shorter arc, then renormalize
+  if (dot(real0, real1) < 0.0)
+  {
+    real1 = -real1;
+    dual1 = -dual1;
+  }
+  vec4 real = mix(real0, real1, vWeight);
+  vec4 dual = mix(dual0, dual1, vWeight);
+  float len = length(real);
+  real /= len;
+  dual /= len;
+
+  // glm: dualquat * vec3
+  vec3 p = vPosition.xyz;
+  p += 2.0 * (cross(real.xyz, cross(real.xyz, p) + p * real.w + dual.xyz) + dual.xyz * real.w - real.xyz * dual.w);
+
+  gl_Position = mViewProj * mWorld * mRoot * vec4(p, 1.0);
+  color = vColor;
+}
@@ -0,0 +1,21 @@
+#version 150
+
+in  vec4 vPosition;
+in  vec4 vColor;
+out vec4 color;
+
+#include "cubevertex.glsl"
+
+#include "camera.glsl"
+
+layout(std140) uniform Part
+{
+  mat4 mModel;
+};
+
+void main()
+{
+  vec4 position;
+  cubeVertex(position, color);
+  gl_Position = mViewProj * mModel * position;
+}